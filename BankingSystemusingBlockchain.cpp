@@ -1,499 +1,4967 @@
-#include <bits/stdc++.h>
-using namespace std;
-
-#define TABLE_SIZE 10 // Hash table size
-
-struct Block {
-    int index{};
-    string transactionID;
-    string previousHash;
-    time_t timestamp{};
-    string data;
-    string hash;
-    Block* next{nullptr};
-};
-
-struct BSTNode {
-    string transactionID;
-    BSTNode *left{nullptr}, *right{nullptr};
-};
-
-struct Blockchain {
-    Block* head{nullptr};
-    int length{0};
-    BSTNode* root{nullptr}; // BST of transaction IDs (not used elsewhere, retained)
-} blockchain;
-
-struct User {
-    string accountNumber;
-    string name;
-    string mobile;
-    string password;
-    float balance{};
-    User* next{nullptr}; // used both for the users list and hash buckets as in original
-};
-
-struct BankDatabase {
-    User* users{nullptr};
-    int nextAccountNumber{1};
-    User* hashTable[TABLE_SIZE]{};
-};
-
-// ---------- Helpers ----------
-static int hashFunction(const string& s) {
-    unsigned long h = 5381;
-    for (unsigned char c : s) h = h * 33 + c;
-    return static_cast<int>(h % TABLE_SIZE);
-}
-
-static string computeHash(const string& s) {
-    unsigned long h = 5381;
-    for (unsigned char c : s) h = h * 33 + c;
-    return to_string(h);
-}
-
-static BSTNode* insertBST(BSTNode* node, const string& transactionID) {
-    if (!node) {
-        auto* temp = new BSTNode();
-        temp->transactionID = transactionID;
-        return temp;
-    }
-    if (transactionID < node->transactionID) node->left = insertBST(node->left, transactionID);
-    else node->right = insertBST(node->right, transactionID);
-    return node;
-}
-
-static void addBlock(const string& data) {
-    auto* newBlock = new Block();
-    newBlock->index = blockchain.length++;
-    newBlock->timestamp = time(nullptr);
-    newBlock->data = data;
-    newBlock->transactionID = string("TRX-") + to_string(newBlock->index);
-    newBlock->hash = computeHash(data);
-
-    if (!blockchain.head) {
-        newBlock->previousHash = "0";
-        blockchain.head = newBlock;
-    } else {
-        Block* cur = blockchain.head;
-        while (cur->next) cur = cur->next;
-        newBlock->previousHash = cur->hash;
-        cur->next = newBlock;
-    }
-    blockchain.root = insertBST(blockchain.root, newBlock->transactionID);
-}
-
-static void initBankDatabase(BankDatabase* db) {
-    db->users = nullptr;
-    db->nextAccountNumber = 1;
-    for (int i = 0; i < TABLE_SIZE; ++i) db->hashTable[i] = nullptr;
-}
-
-static User* createUser(BankDatabase* db, const string& name, const string& mobile,
-                        const string& password, float initialDeposit) {
-    auto* newUser = new (nothrow) User();
-    if (!newUser) return nullptr;
-
-    ostringstream acc;
-    acc << "CSAGRP6A" << setw(3) << setfill('0') << db->nextAccountNumber++;
-    newUser->accountNumber = acc.str();
-    newUser->name = name;
-    newUser->mobile = mobile;
-    newUser->password = password;
-    newUser->balance = initialDeposit;
-    newUser->next = nullptr;
-
-    // Append to users list (tail)
-    if (!db->users) db->users = newUser;
-    else {
-        User* cur = db->users;
-        while (cur->next) cur = cur->next;
-        cur->next = newUser;
-    }
-
-    // Add to hash bucket (NOTE: uses same `next` pointer as original C code)
-    int idx = hashFunction(newUser->accountNumber);
-    newUser->next = db->hashTable[idx];
-    db->hashTable[idx] = newUser;
-
-    return newUser;
-}
-
-static User* findUser(BankDatabase* db, const string& accountNumber) {
-    int idx = hashFunction(accountNumber);
-    User* cur = db->hashTable[idx];
-    while (cur) {
-        if (cur->accountNumber == accountNumber) return cur;
-        cur = cur->next;
-    }
-    return nullptr;
-}
-
-// ---------- CSV I/O ----------
-static void saveUsersToCSV(BankDatabase* db, const string& filename) {
-    ofstream file(filename);
-    if (!file) {
-        cerr << "Failed to open file: " << filename << "\n";
-        return;
-    }
-    file << "AccountNumber,Name,Mobile,Password,Balance\n";
-    // Iterating over db->users may be unreliable due to shared `next` usage; write via buckets for safety
-    vector<User*> seen;
-    seen.reserve(128);
-    for (int i = 0; i < TABLE_SIZE; ++i) {
-        for (User* cur = db->hashTable[i]; cur; cur = cur->next) {
-            // avoid duplicates
-            if (find(seen.begin(), seen.end(), cur) != seen.end()) continue;
-            seen.push_back(cur);
-            file << cur->accountNumber << ','
-                 << cur->name << ','
-                 << cur->mobile << ','
-                 << cur->password << ','
-                 << fixed << setprecision(2) << cur->balance << '\n';
-        }
-    }
-}
-
-static void ensureUsersCSVExists(const string& filename) {
-    ifstream fin(filename);
-    if (fin.good()) return;
-    ofstream fout(filename);
-    if (!fout) {
-        cerr << "Failed to create file: " << filename << "\n";
-        return;
-    }
-    fout << "AccountNumber,Name,Mobile,Password,Balance\n";
-    cerr << "New file created: " << filename << "\n";
-}
-
-static void loadUsersFromCSV(BankDatabase* db, const string& filename) {
-    ensureUsersCSVExists(filename);
-    ifstream file(filename);
-    if (!file) {
-        cerr << "Failed to open file: " << filename << "\n";
-        return;
-    }
-    string line;
-    getline(file, line); // skip header
-    while (getline(file, line)) {
-        if (line.empty()) continue;
-        // naive CSV split (no quoted commas)
-        stringstream ss(line);
-        string accountNumber, name, mobile, password, balanceStr;
-        if (!getline(ss, accountNumber, ',')) continue;
-        if (!getline(ss, name, ',')) continue;
-        if (!getline(ss, mobile, ',')) continue;
-        if (!getline(ss, password, ',')) continue;
-        if (!getline(ss, balanceStr, ',')) continue;
-
-        float balance = stof(balanceStr);
-        User* user = createUser(db, name, mobile, password, balance);
-        if (user) {
-            user->accountNumber = accountNumber; // restore saved account number
-        }
-    }
-}
-
-static void saveTransactionsToCSV(const string& filename) {
-    ofstream file(filename);
-    if (!file) {
-        cerr << "Failed to open file: " << filename << "\n";
-        return;
-    }
-    file << "Index,TransactionID,PreviousHash,Timestamp,Data,Hash\n";
-    for (Block* cur = blockchain.head; cur; cur = cur->next) {
-        file << cur->index << ','
-             << cur->transactionID << ','
-             << cur->previousHash << ','
-             << static_cast<long long>(cur->timestamp) << ','
-             << cur->data << ','
-             << cur->hash << '\n';
-    }
-}
-
-static void ensureTxCSVExists(const string& filename) {
-    ifstream fin(filename);
-    if (fin.good()) return;
-    ofstream fout(filename);
-    if (!fout) {
-        cerr << "Failed to create file: " << filename << "\n";
-        return;
-    }
-    fout << "Index,TransactionID,PreviousHash,Timestamp,Data,Hash\n";
-    cerr << "New transactions file created: " << filename << "\n";
-}
-
-static void loadTransactionsFromCSV(const string& filename) {
-    ensureTxCSVExists(filename);
-    ifstream file(filename);
-    if (!file) {
-        cerr << "Failed to open file: " << filename << "\n";
-        return;
-    }
-    string line;
-    getline(file, line); // header
-    // We will rebuild the linked list in the order found (assumed already chronological)
-    Block* tail = nullptr;
-    while (getline(file, line)) {
-        if (line.empty()) continue;
-        // naive split by comma; note: 'data' must not contain commas to be safe
-        stringstream ss(line);
-        string idxStr, txid, prev, tsStr, data, h;
-        if (!getline(ss, idxStr, ',')) continue;
-        if (!getline(ss, txid, ',')) continue;
-        if (!getline(ss, prev, ',')) continue;
-        if (!getline(ss, tsStr, ',')) continue;
-        if (!getline(ss, data, ',')) continue;
-        if (!getline(ss, h, ',')) continue;
-
-        auto* b = new Block();
-        b->index = stoi(idxStr);
-        b->transactionID = txid;
-        b->previousHash = prev;
-        b->timestamp = static_cast<time_t>(stoll(tsStr));
-        b->data = data;
-        b->hash = h;
-        b->next = nullptr;
-
-        if (!blockchain.head) {
-            blockchain.head = b;
-            tail = b;
-        } else {
-            tail->next = b;
-            tail = b;
-        }
-        blockchain.length = max(blockchain.length, b->index + 1);
-        blockchain.root = insertBST(blockchain.root, b->transactionID);
-    }
-}
-
-// ---------- Banking ops ----------
-static void printUsers(BankDatabase* db) {
-    cout << "List of Users:\n";
-    // safer to iterate buckets to avoid `next` collision issues
-    vector<User*> seen;
-    seen.reserve(128);
-    for (int i = 0; i < TABLE_SIZE; ++i) {
-        for (User* cur = db->hashTable[i]; cur; cur = cur->next) {
-            if (find(seen.begin(), seen.end(), cur) != seen.end()) continue;
-            seen.push_back(cur);
-            cout << "Account #" << cur->accountNumber
-                 << ": " << cur->name
-                 << ", Mobile: " << cur->mobile
-                 << ", Balance: Rs." << fixed << setprecision(2) << cur->balance
-                 << "\n";
-        }
-    }
-}
-
-static bool authenticateUser(BankDatabase* db, const string& accountNumber, const string& password) {
-    User* user = findUser(db, accountNumber);
-    return (user && user->password == password);
-}
-
-static void transaction(BankDatabase* db, const string& accountNumber, float amount, int type) {
-    string password;
-    cout << "Enter password for account " << accountNumber << ": ";
-    cin >> password;
-
-    if (!authenticateUser(db, accountNumber, password)) {
-        cout << "Authentication failed. Transaction aborted.\n";
-        return;
-    }
-
-    User* user = findUser(db, accountNumber);
-    if (!user) {
-        cout << "Account number " << accountNumber << " not found.\n";
-        return;
-    }
-
-    string data;
-    if (type == 1) { // Deposit
-        user->balance += amount;
-        {
-            ostringstream oss;
-            oss << "Deposited Rs." << fixed << setprecision(2) << amount
-                << " to " << user->accountNumber
-                << ". New Balance: Rs." << fixed << setprecision(2) << user->balance;
-            data = oss.str();
-        }
-        cout << "Rs." << fixed << setprecision(2) << amount
-             << " deposited to Account #" << user->accountNumber
-             << ". New Balance: Rs." << fixed << setprecision(2) << user->balance << "\n";
-    } else if (type == 2) { // Withdrawal
-        if (user->balance >= amount) {
-            user->balance -= amount;
-            {
-                ostringstream oss;
-                oss << "Withdrawn Rs." << fixed << setprecision(2) << amount
-                    << " from " << user->accountNumber
-                    << ". New Balance: Rs." << fixed << setprecision(2) << user->balance;
-                data = oss.str();
-            }
-            cout << "Rs." << fixed << setprecision(2) << amount
-                 << " withdrawn from Account #" << user->accountNumber
-                 << ". New Balance: Rs." << fixed << setprecision(2) << user->balance << "\n";
-        } else {
-            cout << "Insufficient funds for withdrawal.\n";
-            return;
-        }
-    } else {
-        cout << "Invalid transaction type.\n";
-        return;
-    }
-    addBlock(data);
-}
-
-static void transfer(BankDatabase* db, const string& fromAccount, const string& toAccount, float amount) {
-    string password;
-    cout << "Enter password for account " << fromAccount << ": ";
-    cin >> password;
-
-    if (!authenticateUser(db, fromAccount, password)) {
-        cout << "Authentication failed. Transfer aborted.\n";
-        return;
-    }
-
-    User* fromUser = findUser(db, fromAccount);
-    User* toUser = findUser(db, toAccount);
-
-    if (!fromUser || !toUser) {
-        cout << "One or both account numbers not found.\n";
-        return;
-    }
-
-    if (fromUser->balance >= amount) {
-        fromUser->balance -= amount;
-        toUser->balance += amount;
-
-        ostringstream oss;
-        oss << "Transferred Rs." << fixed << setprecision(2) << amount
-            << " from " << fromUser->accountNumber
-            << " to " << toUser->accountNumber;
-        string data = oss.str();
-
-        cout << "Rs." << fixed << setprecision(2) << amount
-             << " transferred from Account #" << fromAccount
-             << " to Account #" << toAccount << "\n";
-        addBlock(data);
-    } else {
-        cout << "Insufficient funds in source account.\n";
-    }
-}
-
-// ---------- Menu ----------
-static void menu() {
-    // Choose relative CSV paths for portability
-    const string USERS_CSV = "users.csv";
-    const string TX_CSV = "transactions.csv";
-
-    BankDatabase db;
-    initBankDatabase(&db);
-    loadUsersFromCSV(&db, USERS_CSV);
-    loadTransactionsFromCSV(TX_CSV);
-
-    int choice;
-    string accountNumber;
-    float amount;
-    string name, mobile, password, confirmPassword;
-
-    do {
-        cout << "\n--- Bank Menu ---\n";
-        cout << "1. Create Account\n";
-        cout << "2. Deposit Money\n";
-        cout << "3. Withdraw Money\n";
-        cout << "4. Transfer Money\n";
-        cout << "5. View Accounts\n";
-        cout << "6. Exit\n";
-        cout << "Choose an option: ";
-        if (!(cin >> choice)) {
-            cin.clear();
-            cin.ignore(numeric_limits<streamsize>::max(), '\n');
-            cout << "Invalid input.\n";
-            continue;
-        }
-
-        switch (choice) {
-            case 1: {
-                cout << "Enter name: ";
-                cin >> name; // single-token like original
-                cout << "Enter mobile number: ";
-                cin >> mobile;
-                if (mobile.size() != 10) {
-                    cout << "Error: Mobile number must be exactly 10 digits long.\n";
-                    break;
-                }
-                cout << "Create password: ";
-                cin >> password;
-                cout << "Confirm password: ";
-                cin >> confirmPassword;
-                if (password != confirmPassword) {
-                    cout << "Passwords do not match. Account creation failed.\n";
-                    break;
-                }
-                cout << "Initial deposit: ";
-                cin >> amount;
-
-                User* user = createUser(&db, name, mobile, password, amount);
-                if (user) {
-                    cout << "Account created successfully. Account Number: " << user->accountNumber << "\n";
-                    ostringstream oss;
-                    oss << "Created account for " << name
-                        << " with initial deposit of Rs." << fixed << setprecision(2) << amount
-                        << ". Account Number: " << user->accountNumber;
-                    addBlock(oss.str());
-                    saveUsersToCSV(&db, USERS_CSV);
-                    saveTransactionsToCSV(TX_CSV);
-                }
-                break;
-            }
-            case 2: {
-                cout << "Enter account number: ";
-                cin >> accountNumber;
-                cout << "Enter amount to deposit: ";
-                cin >> amount;
-                transaction(&db, accountNumber, amount, 1);
-                break;
-            }
-            case 3: {
-                cout << "Enter account number: ";
-                cin >> accountNumber;
-                cout << "Enter amount to withdraw: ";
-                cin >> amount;
-                transaction(&db, accountNumber, amount, 2);
-                break;
-            }
-            case 4: {
-                string toAccount;
-                cout << "Enter from account number: ";
-                cin >> accountNumber;
-                cout << "Enter to account number: ";
-                cin >> toAccount;
-                cout << "Enter amount to transfer: ";
-                cin >> amount;
-                transfer(&db, accountNumber, toAccount, amount);
-                saveUsersToCSV(&db, USERS_CSV);
-                saveTransactionsToCSV(TX_CSV);
-                break;
-            }
-            case 5:
-                printUsers(&db);
-                break;
-            case 6:
-                cout << "Exiting and saving data...\n";
-                saveUsersToCSV(&db, USERS_CSV);
-                saveTransactionsToCSV(TX_CSV);
-                cout << "Data saved. Exiting program.\n";
-                break;
-            default:
-                cout << "Invalid option.\n";
-        }
-    } while (choice != 6);
-}
-
-int main() {
-    blockchain.head = nullptr;
-    blockchain.length = 0;
-    menu();
-    return 0;
-}
+#include <bits/stdc++.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/random.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+using namespace std;
+
+using Hash256 = array<uint8_t, 32>; // raw SHA-256 digest
+
+// Fixed-size block header, laid out exactly as in ledger.bin (little-endian).
+// A block seals transactions [firstTx, firstTx + txCount) under merkleRoot.
+struct Block {
+    int64_t index{};
+    int64_t timestamp{};
+    uint64_t firstTx{};
+    uint64_t txCount{};
+    Hash256 previousHash{}; // all-zero for the genesis block
+    Hash256 merkleRoot{};
+    Hash256 hash{};
+};
+static_assert(sizeof(Block) == 128, "Block must match the ledger.bin header layout");
+
+static string transactionID(uint64_t tx) { return "TRX-" + to_string(tx); }
+
+// Growable array stored in fixed-size chunks: O(1) append, stable element
+// addresses and chunk-at-a-time linear iteration.
+template <typename T, size_t CHUNK_BITS = 12>
+struct ChunkedArena {
+    static constexpr size_t CHUNK_SIZE = size_t(1) << CHUNK_BITS;
+    static constexpr size_t CHUNK_MASK = CHUNK_SIZE - 1;
+
+    vector<unique_ptr<T[]>> chunks;
+    size_t count{0};
+
+    size_t size() const { return count; }
+    T& operator[](size_t i) { return chunks[i >> CHUNK_BITS][i & CHUNK_MASK]; }
+    const T& operator[](size_t i) const { return chunks[i >> CHUNK_BITS][i & CHUNK_MASK]; }
+
+    T& push() {
+        if ((count & CHUNK_MASK) == 0 && (count >> CHUNK_BITS) == chunks.size())
+            chunks.emplace_back(new T[CHUNK_SIZE]);
+        return (*this)[count++];
+    }
+
+    template <typename F>
+    void forEach(F&& f) const {
+        for (size_t c = 0, left = count; left; ++c) {
+            size_t n = min(left, CHUNK_SIZE);
+            const T* chunk = chunks[c].get();
+            for (size_t i = 0; i < n; ++i) f(chunk[i]);
+            left -= n;
+        }
+    }
+};
+
+// Block store: a read-only base mapped from ledger.bin followed by chunked
+// arenas of appended block headers and transactions. Block N and transaction N
+// are found in O(1) in either region. Transactions past the last sealed block
+// are pending and are sealed into the next block.
+struct BlockStore {
+    // Mapped base (see openLedger)
+    const Block* baseHeaders{nullptr};
+    size_t baseCount{0};
+    const uint64_t* baseTxOffsets{nullptr}; // baseTxCount + 1 offsets into basePayload
+    const char* basePayload{nullptr};
+    size_t baseTxCount{0};
+    void* mapping{nullptr};
+    size_t mappingSize{0};
+
+    ChunkedArena<Block> headers; // blocks after the base
+    ChunkedArena<string> txs;    // transactions after the base, sealed or pending
+
+    size_t size() const { return baseCount + headers.size(); }
+    bool empty() const { return size() == 0; }
+    uint64_t txCount() const { return baseTxCount + txs.size(); }
+
+    const Block& operator[](size_t i) const { return i < baseCount ? baseHeaders[i] : headers[i - baseCount]; }
+    const Block* back() const { return empty() ? nullptr : &(*this)[size() - 1]; }
+
+    uint64_t sealedTxCount() const {
+        const Block* b = back();
+        return b ? b->firstTx + b->txCount : 0;
+    }
+
+    string_view tx(uint64_t n) const {
+        if (n < baseTxCount) return {basePayload + baseTxOffsets[n], size_t(baseTxOffsets[n + 1] - baseTxOffsets[n])};
+        return txs[n - baseTxCount];
+    }
+
+    // Mutable access is limited to appended (unmapped) blocks.
+    Block& appended(size_t i) { return headers[i - baseCount]; }
+    Block& append() { return headers.push(); }
+    uint64_t appendTx(string data) {
+        txs.push() = std::move(data);
+        return txCount() - 1;
+    }
+
+    // Visit every block in chain order: the mapped base, then the arena.
+    template <typename F>
+    void forEach(F&& f) const {
+        for (size_t i = 0; i < baseCount; ++i) f(baseHeaders[i]);
+        headers.forEach(f);
+    }
+
+    // Visit the transactions sealed in block b as (number, data).
+    template <typename F>
+    void forEachTx(const Block& b, F&& f) const {
+        for (uint64_t n = b.firstTx; n < b.firstTx + b.txCount; ++n) f(n, tx(n));
+    }
+
+    void clear() {
+        if (mapping) munmap(mapping, mappingSize);
+        *this = BlockStore();
+    }
+};
+
+// Pending transactions are sealed into a block once there are maxTxs of
+// them or the oldest has waited maxAge.
+struct SealPolicy {
+    size_t maxTxs{256};
+    chrono::milliseconds maxAge{1000};
+};
+
+// Money is held as an integer number of paise (1/100 rupee).
+using Money = int64_t;
+
+// Sparse time directory over the sealed blocks (see "Time range queries").
+struct TimeSegment {
+    int64_t minTs, maxTs;
+    bool ordered; // timestamps never decrease within the segment
+};
+struct TimeIndex {
+    vector<TimeSegment> segments; // one per complete segment; the partial tail is scanned
+    vector<size_t> runs;          // first segment of each run of ordered segments that follow each other in time
+};
+
+struct Blockchain {
+    BlockStore blocks;
+    SealPolicy policy;
+    chrono::steady_clock::time_point pendingSince{};
+    vector<Money> txDelta;  // money each transaction from deltaFirstTx on adds to the bank's total
+    uint64_t deltaFirstTx{0};
+    Money deltaBase{0};     // total of the transactions before deltaFirstTx (from a snapshot)
+    TimeIndex timeIndex;    // extended on demand; reset whenever the store is reloaded
+} blockchain;
+
+struct User {
+    string accountNumber;
+    string name;
+    string mobile;
+    string passwordHash; // see hashPassword
+    Money balance{};
+    vector<uint64_t> history; // transactions touching this account, ascending
+    Hash256 authTag{};       // keyed tag of the last verified password (see authenticateUser)
+    chrono::steady_clock::time_point authExpires{};
+};
+
+// Open-addressing account index in the style of a Swiss table: one control
+// byte per slot (0x80 = empty, else a 7-bit tag from the hash) scanned 16 at a
+// time with SSE2, so a lookup is usually one group compare plus one string compare.
+struct AccountIndex {
+    static constexpr size_t GROUP = 16;
+    static constexpr uint8_t EMPTY = 0x80;
+
+    vector<uint8_t> ctrl;  // capacity control bytes
+    vector<User*> slots;   // capacity entries
+    size_t count{0};
+
+    static uint64_t hash(string_view key) {
+        uint64_t h = 0xcbf29ce484222325ULL; // FNV-1a, then a murmur3 finalizer for the high bits
+        for (unsigned char c : key) h = (h ^ c) * 0x100000001b3ULL;
+        h ^= h >> 33; h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33; h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    size_t capacity() const { return slots.size(); }
+    size_t size() const { return count; }
+
+    // Bitmask of slots in group g whose control byte equals `tag`.
+    uint32_t match(size_t g, uint8_t tag) const {
+        const uint8_t* p = ctrl.data() + g * GROUP;
+#ifdef __SSE2__
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(static_cast<char>(tag)))));
+#else
+        uint32_t m = 0;
+        for (size_t i = 0; i < GROUP; ++i) m |= uint32_t(p[i] == tag) << i;
+        return m;
+#endif
+    }
+
+    User* find(string_view key) const {
+        if (!count) return nullptr;
+        const uint64_t h = hash(key);
+        const uint8_t tag = h & 0x7F;
+        const size_t groups = capacity() / GROUP;
+        // Triangular probing over groups visits every group once for power-of-two counts.
+        for (size_t g = (h >> 7) & (groups - 1), step = 1;; g = (g + step++) & (groups - 1)) {
+            for (uint32_t m = match(g, tag); m; m &= m - 1) {
+                User* u = slots[g * GROUP + __builtin_ctz(m)];
+                if (u->accountNumber == key) return u;
+            }
+            if (match(g, EMPTY)) return nullptr;
+        }
+    }
+
+    void insertUnique(User* u) {
+        if ((count + 1) * 8 > capacity() * 7) reserve(max<size_t>(count + 1, capacity()));
+        const uint64_t h = hash(u->accountNumber);
+        const size_t groups = capacity() / GROUP;
+        for (size_t g = (h >> 7) & (groups - 1), step = 1;; g = (g + step++) & (groups - 1)) {
+            if (uint32_t m = match(g, EMPTY)) {
+                size_t slot = g * GROUP + __builtin_ctz(m);
+                ctrl[slot] = h & 0x7F;
+                slots[slot] = u;
+                ++count;
+                return;
+            }
+        }
+    }
+
+    // Size for at least n accounts at <= 7/8 load; rehashes existing entries.
+    void reserve(size_t n) {
+        size_t want = GROUP;
+        while (want * 7 < n * 8) want *= 2;
+        if (want <= capacity() && (count + 1) * 8 <= capacity() * 7) return;
+        if (want <= capacity()) want = capacity() * 2;
+        vector<User*> old;
+        old.reserve(count);
+        for (size_t i = 0; i < capacity(); ++i)
+            if (ctrl[i] != EMPTY) old.push_back(slots[i]);
+        ctrl.assign(want, EMPTY);
+        slots.assign(want, nullptr);
+        count = 0;
+        for (User* u : old) insertUnique(u);
+    }
+};
+
+// Canonical account table: users live in a deque (stable addresses for the
+// index) and `accounts` lists them in ascending account-number order, the one
+// order used for saving and listing.
+struct BankDatabase {
+    deque<User> storage;
+    vector<User*> accounts;
+    bool accountsSorted{true}; // false after restoring an account out of order
+    int nextAccountNumber{1};
+    AccountIndex index;
+};
+
+// ---------- Money ----------
+static constexpr Money MONEY_MAX = 1'000'000'000'000'000; // Rs.10^13, far below int64 overflow
+
+// Scan an amount ("-"? digits ("." 1-2 digits)?) at the start of s; returns
+// the characters consumed, 0 if there is no amount or it exceeds MONEY_MAX.
+static size_t scanMoney(string_view s, Money& out) {
+    size_t i = 0;
+    bool negative = i < s.size() && s[i] == '-';
+    if (negative) ++i;
+    size_t start = i;
+    Money v = 0;
+    for (; i < s.size() && isdigit(static_cast<unsigned char>(s[i])); ++i) {
+        v = v * 10 + (s[i] - '0');
+        if (v > MONEY_MAX / 100) return 0;
+    }
+    if (i == start) return 0;
+    v *= 100;
+    if (i + 1 < s.size() && s[i] == '.' && isdigit(static_cast<unsigned char>(s[i + 1]))) {
+        v += (s[i + 1] - '0') * 10;
+        i += 2;
+        if (i < s.size() && isdigit(static_cast<unsigned char>(s[i]))) v += s[i++] - '0';
+    }
+    out = negative ? -v : v;
+    return i;
+}
+
+static bool parseMoney(string_view s, Money& out) {
+    return !s.empty() && scanMoney(s, out) == s.size();
+}
+
+// Append "<rupees>.<paise>" without going through printf.
+static void appendMoney(string& out, Money m) {
+    char buf[24];
+    char* e = buf + sizeof(buf);
+    uint64_t u = m < 0 ? 0 - static_cast<uint64_t>(m) : static_cast<uint64_t>(m);
+    *--e = char('0' + u % 10);
+    u /= 10;
+    *--e = char('0' + u % 10);
+    u /= 10;
+    *--e = '.';
+    do {
+        *--e = char('0' + u % 10);
+        u /= 10;
+    } while (u);
+    if (m < 0) *--e = '-';
+    out.append(e, buf + sizeof(buf));
+}
+
+static string moneyString(Money m) {
+    string s;
+    appendMoney(s, m);
+    return s;
+}
+
+// ---------- Instrumentation ----------
+// Call counts and latency histograms for the hot paths. Each thread records
+// into its own block with relaxed plain stores (no lock prefix, no shared
+// cache lines); readers sum the blocks. Blocks of finished threads go back
+// to a free list and keep their counts, so short-lived workers do not leak.
+// Latencies are TSC ticks on x86 (steady_clock ns elsewhere), bucketed
+// HDR-style: 8 linear sub-buckets per power of two, about 12% precision.
+// Reading the clock around a 50 ns lookup stalls the lookups that would
+// otherwise overlap, so the hottest probes count every call but time only
+// one in 2^PROBE_SAMPLE_SHIFT of them.
+//
+// Build with -DBANK_STATS=0 to compile every probe out.
+#ifndef BANK_STATS
+#define BANK_STATS 1
+#endif
+
+enum class Probe : uint8_t {
+    FindUser, Authenticate, PasswordHash, AddTransaction, SealBlock, BlockHash, MerkleRoot,
+    SaveUsers, LoadUsers, SaveTransactions, LoadTransactions, WriteLedger, OpenLedger,
+    ReplayJournal, WriteSnapshot, LoadSnapshot, TimeRange, Count
+};
+static const char* const PROBE_NAMES[] = {
+    "findUser", "authenticateUser", "passwordHash", "addTransaction", "sealBlock", "blockHash", "merkleRoot",
+    "saveUsersToCSV", "loadUsersFromCSV", "saveTransactionsToCSV", "loadTransactionsFromCSV", "writeLedger",
+    "openLedger", "replayJournal", "writeSnapshot", "loadSnapshot", "findBlocksInTime"};
+
+enum class Counter : uint8_t { FindUserMiss, AuthSession, AuthCached, AuthFailed, Count };
+static const char* const COUNTER_NAMES[] = {"findUserMiss", "authSession", "authCached", "authFailed"};
+
+static constexpr size_t PROBES = size_t(Probe::Count), COUNTERS = size_t(Counter::Count);
+static constexpr uint8_t PROBE_SAMPLE_SHIFT[PROBES] = {6, 4, 0, 6, 0, 4};
+static constexpr size_t HISTOGRAM_BUCKETS = 496; // values up to 2^64 ticks
+
+struct ProbeSummary {
+    uint64_t count{0}, timed{0};
+    double avgNs{0}, p50Ns{0}, p90Ns{0}, p99Ns{0}, p999Ns{0}, maxNs{0};
+};
+
+#if BANK_STATS
+static inline uint64_t probeTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+static inline size_t histogramBucket(uint64_t v) {
+    if (v < 8) return size_t(v);
+    int e = 63 - __builtin_clzll(v);
+    return size_t(e - 2) * 8 + size_t((v >> (e - 3)) & 7);
+}
+
+// Midpoint of a bucket, in ticks.
+static double histogramValue(size_t b) {
+    if (b < 8) return double(b);
+    int e = int(b / 8) + 2;
+    return (double(8 + b % 8) + 0.5) * ldexp(1.0, e - 3);
+}
+
+struct ProbeCounters {
+    atomic<uint64_t> count{0}, timed{0}, ticks{0}, maxTicks{0};
+    atomic<uint64_t> histogram[HISTOGRAM_BUCKETS]{};
+};
+
+struct ThreadStats {
+    ProbeCounters probes[PROBES];
+    atomic<uint64_t> counters[COUNTERS]{};
+};
+
+// Only the owning thread writes, so load + store needs no read-modify-write.
+static inline void bump(atomic<uint64_t>& a, uint64_t by = 1) {
+    a.store(a.load(memory_order_relaxed) + by, memory_order_relaxed);
+}
+
+struct StatsRegistry {
+    mutex m;
+    deque<ThreadStats> blocks; // stable addresses
+    vector<ThreadStats*> free;
+    const chrono::steady_clock::time_point startTime{chrono::steady_clock::now()};
+    const uint64_t startTicks{probeTicks()};
+} statsRegistry;
+
+struct ThreadStatsHandle {
+    ThreadStats* stats{nullptr};
+
+    ThreadStats& get() {
+        if (!stats) {
+            lock_guard<mutex> lock(statsRegistry.m);
+            if (statsRegistry.free.empty()) {
+                stats = &statsRegistry.blocks.emplace_back();
+            } else {
+                stats = statsRegistry.free.back();
+                statsRegistry.free.pop_back();
+            }
+        }
+        return *stats;
+    }
+    ~ThreadStatsHandle() {
+        if (!stats) return;
+        lock_guard<mutex> lock(statsRegistry.m);
+        statsRegistry.free.push_back(stats);
+    }
+};
+static thread_local ThreadStatsHandle threadStats;
+
+struct ProbeTimer {
+    ProbeCounters* c{nullptr}; // null when this call is not timed
+    uint64_t start{0};
+
+    explicit ProbeTimer(Probe p) {
+        ProbeCounters& counters = threadStats.get().probes[size_t(p)];
+        uint64_t n = counters.count.load(memory_order_relaxed);
+        counters.count.store(n + 1, memory_order_relaxed);
+        if (n & ((uint64_t(1) << PROBE_SAMPLE_SHIFT[size_t(p)]) - 1)) return;
+        c = &counters;
+        start = probeTicks();
+    }
+    ~ProbeTimer() {
+        if (!c) return;
+        uint64_t d = probeTicks() - start;
+        bump(c->timed);
+        bump(c->ticks, d);
+        if (d > c->maxTicks.load(memory_order_relaxed)) c->maxTicks.store(d, memory_order_relaxed);
+        bump(c->histogram[histogramBucket(d)]);
+    }
+};
+
+#define STAT_SCOPE(p) ProbeTimer probeScope(p)
+#define STAT_COUNT(c) bump(threadStats.get().counters[size_t(c)])
+
+// Ticks per nanosecond, measured over the process lifetime (at least 10 ms).
+static double ticksPerNs() {
+#if defined(__x86_64__) || defined(__i386__)
+    auto elapsed = chrono::steady_clock::now() - statsRegistry.startTime;
+    if (elapsed < chrono::milliseconds(10)) this_thread::sleep_for(chrono::milliseconds(10) - elapsed);
+    double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - statsRegistry.startTime).count();
+    return (probeTicks() - statsRegistry.startTicks) / ns;
+#else
+    return 1.0;
+#endif
+}
+
+// Merge every thread's block into per-probe summaries and counter totals.
+static void readStats(ProbeSummary out[PROBES], uint64_t counters[COUNTERS]) {
+    const double perNs = ticksPerNs();
+    vector<uint64_t> histogram(HISTOGRAM_BUCKETS);
+    lock_guard<mutex> lock(statsRegistry.m);
+    for (size_t k = 0; k < COUNTERS; ++k) {
+        counters[k] = 0;
+        for (const ThreadStats& t : statsRegistry.blocks) counters[k] += t.counters[k].load(memory_order_relaxed);
+    }
+    for (size_t p = 0; p < PROBES; ++p) {
+        ProbeSummary& s = out[p] = ProbeSummary();
+        uint64_t ticks = 0, maxTicks = 0;
+        fill(histogram.begin(), histogram.end(), 0);
+        for (const ThreadStats& t : statsRegistry.blocks) {
+            const ProbeCounters& c = t.probes[p];
+            s.count += c.count.load(memory_order_relaxed);
+            s.timed += c.timed.load(memory_order_relaxed);
+            ticks += c.ticks.load(memory_order_relaxed);
+            maxTicks = max(maxTicks, c.maxTicks.load(memory_order_relaxed));
+            for (size_t b = 0; b < HISTOGRAM_BUCKETS; ++b) histogram[b] += c.histogram[b].load(memory_order_relaxed);
+        }
+        if (!s.timed) continue;
+        s.avgNs = ticks / perNs / s.timed;
+        s.maxNs = maxTicks / perNs;
+        // Histogram totals can trail `timed` by an in-flight record; rank against their own sum.
+        uint64_t total = accumulate(histogram.begin(), histogram.end(), uint64_t(0)), seen = 0;
+        double* const targets[] = {&s.p50Ns, &s.p90Ns, &s.p99Ns, &s.p999Ns};
+        const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+        size_t q = 0;
+        for (size_t b = 0; b < HISTOGRAM_BUCKETS && q < 4; ++b) {
+            seen += histogram[b];
+            while (q < 4 && seen > quantiles[q] * total) *targets[q++] = min(histogramValue(b) / perNs, s.maxNs);
+        }
+    }
+}
+#else
+#define STAT_SCOPE(p) \
+    do {              \
+    } while (0)
+#define STAT_COUNT(c) \
+    do {              \
+    } while (0)
+
+static void readStats(ProbeSummary out[PROBES], uint64_t counters[COUNTERS]) {
+    for (size_t p = 0; p < PROBES; ++p) out[p] = ProbeSummary();
+    for (size_t k = 0; k < COUNTERS; ++k) counters[k] = 0;
+}
+#endif
+
+// Human-readable table for the Stats menu entry.
+static void printStats(ostream& out) {
+    if (!BANK_STATS) {
+        out << "Instrumentation is compiled out (built with BANK_STATS=0).\n";
+        return;
+    }
+    ProbeSummary probes[PROBES];
+    uint64_t counters[COUNTERS];
+    readStats(probes, counters);
+    char line[160];
+    snprintf(line, sizeof(line), "%-24s %10s %10s %10s %10s %10s %10s\n", "probe (us)", "calls", "avg", "p50", "p99",
+             "p99.9", "max");
+    out << line;
+    for (size_t p = 0; p < PROBES; ++p) {
+        const ProbeSummary& s = probes[p];
+        if (!s.count) continue;
+        snprintf(line, sizeof(line), "%-24s %10llu %10.2f %10.2f %10.2f %10.2f %10.2f\n", PROBE_NAMES[p],
+                 static_cast<unsigned long long>(s.count), s.avgNs / 1e3, s.p50Ns / 1e3, s.p99Ns / 1e3,
+                 s.p999Ns / 1e3, s.maxNs / 1e3);
+        out << line;
+    }
+    for (size_t k = 0; k < COUNTERS; ++k) out << COUNTER_NAMES[k] << ' ' << counters[k] << (k + 1 < COUNTERS ? ", " : "\n");
+}
+
+// One JSON object (no trailing newline) for the periodic dump.
+static string statsJson() {
+    ProbeSummary probes[PROBES];
+    uint64_t counters[COUNTERS];
+    readStats(probes, counters);
+    string out = "{\"time\":" + to_string(static_cast<long long>(time(nullptr))) + ",\"probes\":{";
+    char buf[256];
+    for (size_t p = 0; p < PROBES; ++p) {
+        const ProbeSummary& s = probes[p];
+        snprintf(buf, sizeof(buf),
+                 "%s\"%s\":{\"count\":%llu,\"timed\":%llu,\"avg_ns\":%.0f,\"p50_ns\":%.0f,\"p90_ns\":%.0f,\"p99_ns\":%.0f,"
+                 "\"p999_ns\":%.0f,\"max_ns\":%.0f}",
+                 p ? "," : "", PROBE_NAMES[p], static_cast<unsigned long long>(s.count),
+                 static_cast<unsigned long long>(s.timed), s.avgNs, s.p50Ns, s.p90Ns,
+                 s.p99Ns, s.p999Ns, s.maxNs);
+        out += buf;
+    }
+    out += "},\"counters\":{";
+    for (size_t k = 0; k < COUNTERS; ++k)
+        out += (k ? ",\"" : "\"") + string(COUNTER_NAMES[k]) + "\":" + to_string(counters[k]);
+    out += "}}";
+    return out;
+}
+
+// Appends statsJson() lines to a file every `interval` and once more on exit.
+struct StatsDumper {
+    thread worker;
+    mutex m;
+    condition_variable cv;
+    bool stop{false};
+    string path;
+    chrono::seconds interval{10};
+} statsDumper;
+
+static void dumpStats() {
+    ofstream out(statsDumper.path, ios::app);
+    out << statsJson() << "\n";
+    if (!out) cerr << "Failed to write stats to " << statsDumper.path << "\n";
+}
+
+static void stopStatsDump() {
+    if (!statsDumper.worker.joinable()) return;
+    {
+        lock_guard<mutex> lock(statsDumper.m);
+        statsDumper.stop = true;
+    }
+    statsDumper.cv.notify_one();
+    statsDumper.worker.join();
+    dumpStats();
+}
+
+static void startStatsDump(const string& path) {
+    if (statsDumper.worker.joinable()) return;
+    statsDumper.path = path;
+    statsDumper.worker = thread([] {
+        unique_lock<mutex> lock(statsDumper.m);
+        while (!statsDumper.cv.wait_for(lock, statsDumper.interval, [] { return statsDumper.stop; })) dumpStats();
+    });
+    atexit(stopStatsDump);
+}
+
+// ---------- SHA-256 ----------
+// Portable scalar kernel plus SHA-NI (single stream) and AVX2 (8 independent
+// equal-length messages) kernels, picked once at startup from CPUID.
+static const uint32_t SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+static const uint32_t SHA256_IV[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                      0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+static inline uint32_t rotr32(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+static inline uint32_t loadBE32(const uint8_t* p) {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+static inline void storeBE32(uint8_t* p, uint32_t v) {
+    p[0] = uint8_t(v >> 24); p[1] = uint8_t(v >> 16); p[2] = uint8_t(v >> 8); p[3] = uint8_t(v);
+}
+
+static void sha256CompressScalar(uint32_t state[8], const uint8_t* data, size_t blocks) {
+    uint32_t w[64];
+    for (; blocks; --blocks, data += 64) {
+        for (int t = 0; t < 16; ++t) w[t] = loadBE32(data + 4 * t);
+        for (int t = 16; t < 64; ++t) {
+            uint32_t s0 = rotr32(w[t - 15], 7) ^ rotr32(w[t - 15], 18) ^ (w[t - 15] >> 3);
+            uint32_t s1 = rotr32(w[t - 2], 17) ^ rotr32(w[t - 2], 19) ^ (w[t - 2] >> 10);
+            w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+        }
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int t = 0; t < 64; ++t) {
+            uint32_t t1 = h + (rotr32(e, 6) ^ rotr32(e, 11) ^ rotr32(e, 25)) + ((e & f) ^ (~e & g)) + SHA256_K[t] + w[t];
+            uint32_t t2 = (rotr32(a, 2) ^ rotr32(a, 13) ^ rotr32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+        }
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SHA256_HAVE_X86 1
+
+__attribute__((target("sha,sse4.1")))
+static void sha256CompressShaNi(uint32_t state[8], const uint8_t* data, size_t blocks) {
+    const __m128i MASK = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i tmp = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0]));
+    __m128i state1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[4]));
+    tmp = _mm_shuffle_epi32(tmp, 0xB1);          // CDAB
+    state1 = _mm_shuffle_epi32(state1, 0x1B);    // EFGH
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8); // ABEF
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0); // CDGH
+
+    for (; blocks; --blocks, data += 64) {
+        const __m128i abefSave = state0, cdghSave = state1;
+        __m128i w[4];
+#pragma GCC unroll 16
+        for (int i = 0; i < 16; ++i) {
+            if (i < 4) w[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16 * i)), MASK);
+            __m128i msg = _mm_add_epi32(w[i & 3], _mm_loadu_si128(reinterpret_cast<const __m128i*>(&SHA256_K[4 * i])));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            msg = _mm_shuffle_epi32(msg, 0x0E);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+            if (i >= 3 && i < 15) {
+                // W[i+1] = msg2(msg1(W[i-3], W[i-2]) + W[i-1..i] shifted, W[i])
+                __m128i& next = w[(i + 1) & 3];
+                next = _mm_sha256msg1_epu32(next, w[(i + 2) & 3]);
+                next = _mm_add_epi32(next, _mm_alignr_epi8(w[i & 3], w[(i + 3) & 3], 4));
+                next = _mm_sha256msg2_epu32(next, w[i & 3]);
+            }
+        }
+        state0 = _mm_add_epi32(state0, abefSave);
+        state1 = _mm_add_epi32(state1, cdghSave);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);       // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xB1);    // DCHG
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0); // DCBA
+    state1 = _mm_alignr_epi8(state1, tmp, 8);    // ABEF
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), state0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), state1);
+}
+
+// Eight-lane kernel: lane j of every vector belongs to message j. Each lane's
+// block pointer is supplied separately so callers can mix data and padding.
+__attribute__((target("avx2")))
+static void sha256CompressAvx2x8(__m256i st[8], const uint8_t* const blk[8]) {
+#define ROTR8(x, n) _mm256_or_si256(_mm256_srli_epi32((x), (n)), _mm256_slli_epi32((x), 32 - (n)))
+    __m256i w[16];
+    for (int t = 0; t < 16; ++t)
+        w[t] = _mm256_set_epi32(int(loadBE32(blk[7] + 4 * t)), int(loadBE32(blk[6] + 4 * t)),
+                                int(loadBE32(blk[5] + 4 * t)), int(loadBE32(blk[4] + 4 * t)),
+                                int(loadBE32(blk[3] + 4 * t)), int(loadBE32(blk[2] + 4 * t)),
+                                int(loadBE32(blk[1] + 4 * t)), int(loadBE32(blk[0] + 4 * t)));
+    __m256i a = st[0], b = st[1], c = st[2], d = st[3], e = st[4], f = st[5], g = st[6], h = st[7];
+    for (int t = 0; t < 64; ++t) {
+        __m256i wt;
+        if (t < 16) wt = w[t];
+        else {
+            __m256i w15 = w[(t - 15) & 15], w2 = w[(t - 2) & 15];
+            __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(ROTR8(w15, 7), ROTR8(w15, 18)), _mm256_srli_epi32(w15, 3));
+            __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(ROTR8(w2, 17), ROTR8(w2, 19)), _mm256_srli_epi32(w2, 10));
+            wt = _mm256_add_epi32(_mm256_add_epi32(w[t & 15], s0), _mm256_add_epi32(w[(t - 7) & 15], s1));
+            w[t & 15] = wt;
+        }
+        __m256i S1 = _mm256_xor_si256(_mm256_xor_si256(ROTR8(e, 6), ROTR8(e, 11)), ROTR8(e, 25));
+        __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+        __m256i t1 = _mm256_add_epi32(_mm256_add_epi32(h, S1),
+                                      _mm256_add_epi32(_mm256_add_epi32(ch, _mm256_set1_epi32(int(SHA256_K[t]))), wt));
+        __m256i S0 = _mm256_xor_si256(_mm256_xor_si256(ROTR8(a, 2), ROTR8(a, 13)), ROTR8(a, 22));
+        __m256i maj = _mm256_xor_si256(_mm256_xor_si256(_mm256_and_si256(a, b), _mm256_and_si256(a, c)),
+                                       _mm256_and_si256(b, c));
+        __m256i t2 = _mm256_add_epi32(S0, maj);
+        h = g; g = f; f = e; e = _mm256_add_epi32(d, t1);
+        d = c; c = b; b = a; a = _mm256_add_epi32(t1, t2);
+    }
+#undef ROTR8
+    st[0] = _mm256_add_epi32(st[0], a); st[1] = _mm256_add_epi32(st[1], b);
+    st[2] = _mm256_add_epi32(st[2], c); st[3] = _mm256_add_epi32(st[3], d);
+    st[4] = _mm256_add_epi32(st[4], e); st[5] = _mm256_add_epi32(st[5], f);
+    st[6] = _mm256_add_epi32(st[6], g); st[7] = _mm256_add_epi32(st[7], h);
+}
+
+// Hash eight messages of identical length `len` in parallel.
+__attribute__((target("avx2")))
+static void sha256x8Avx2(const uint8_t* const msgs[8], size_t len, Hash256 out[8]) {
+    __m256i st[8];
+    for (int i = 0; i < 8; ++i) st[i] = _mm256_set1_epi32(int(SHA256_IV[i]));
+
+    const size_t full = len / 64;
+    const uint8_t* blk[8];
+    for (size_t n = 0; n < full; ++n) {
+        for (int j = 0; j < 8; ++j) blk[j] = msgs[j] + 64 * n;
+        sha256CompressAvx2x8(st, blk);
+    }
+
+    // Padding tail is the same shape for every lane: 1 or 2 blocks.
+    const size_t rem = len % 64;
+    const size_t tailBlocks = rem + 9 > 64 ? 2 : 1;
+    alignas(32) uint8_t tail[8][128];
+    for (int j = 0; j < 8; ++j) {
+        memset(tail[j], 0, sizeof(tail[j]));
+        memcpy(tail[j], msgs[j] + 64 * full, rem);
+        tail[j][rem] = 0x80;
+        uint64_t bits = uint64_t(len) * 8;
+        for (int k = 0; k < 8; ++k) tail[j][tailBlocks * 64 - 1 - k] = uint8_t(bits >> (8 * k));
+    }
+    for (size_t n = 0; n < tailBlocks; ++n) {
+        for (int j = 0; j < 8; ++j) blk[j] = tail[j] + 64 * n;
+        sha256CompressAvx2x8(st, blk);
+    }
+
+    alignas(32) uint32_t lanes[8][8];
+    for (int i = 0; i < 8; ++i) _mm256_store_si256(reinterpret_cast<__m256i*>(lanes[i]), st[i]);
+    for (int j = 0; j < 8; ++j)
+        for (int i = 0; i < 8; ++i) storeBE32(out[j].data() + 4 * i, lanes[i][j]);
+}
+
+static bool cpuHasShaNi() {
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return false;
+    return (ebx & (1u << 29)) && __builtin_cpu_supports("sse4.1");
+}
+#endif
+
+using Sha256CompressFn = void (*)(uint32_t state[8], const uint8_t* data, size_t blocks);
+
+struct Sha256Dispatch {
+    Sha256CompressFn compress{sha256CompressScalar};
+    bool avx2x8{false};
+    const char* name{"scalar"};
+
+    Sha256Dispatch() {
+#ifdef SHA256_HAVE_X86
+        __builtin_cpu_init();
+        // SHA-NI beats eight AVX2 lanes per message, so batches only go wide without it.
+        if (cpuHasShaNi()) {
+            compress = sha256CompressShaNi;
+            name = "sha-ni";
+        } else if (__builtin_cpu_supports("avx2")) {
+            avx2x8 = true;
+            name = "scalar+avx2x8";
+        }
+#endif
+    }
+};
+
+static const Sha256Dispatch& sha256Impl() {
+    static const Sha256Dispatch d;
+    return d;
+}
+
+static Hash256 sha256(const void* data, size_t len) {
+    const auto* p = static_cast<const uint8_t*>(data);
+    const Sha256CompressFn compress = sha256Impl().compress;
+    uint32_t state[8];
+    memcpy(state, SHA256_IV, sizeof(state));
+
+    const size_t full = len / 64;
+    if (full) compress(state, p, full);
+
+    const size_t rem = len % 64;
+    uint8_t tail[128] = {};
+    memcpy(tail, p + 64 * full, rem);
+    tail[rem] = 0x80;
+    const size_t tailBlocks = rem + 9 > 64 ? 2 : 1;
+    const uint64_t bits = uint64_t(len) * 8;
+    for (int k = 0; k < 8; ++k) tail[tailBlocks * 64 - 1 - k] = uint8_t(bits >> (8 * k));
+    compress(state, tail, tailBlocks);
+
+    Hash256 out;
+    for (int i = 0; i < 8; ++i) storeBE32(out.data() + 4 * i, state[i]);
+    return out;
+}
+
+// Hash `n` messages that all have length `len`, eight at a time where AVX2 is available.
+static void sha256Batch(const uint8_t* const* msgs, size_t len, Hash256* out, size_t n) {
+    size_t i = 0;
+#ifdef SHA256_HAVE_X86
+    if (sha256Impl().avx2x8)
+        for (; i + 8 <= n; i += 8) sha256x8Avx2(msgs + i, len, out + i);
+#endif
+    for (; i < n; ++i) out[i] = sha256(msgs[i], len);
+}
+
+// Streaming SHA-256 for messages assembled from several pieces.
+struct Sha256Ctx {
+    uint32_t state[8];
+    uint8_t buf[64];
+    size_t bufLen{0};
+    uint64_t total{0};
+
+    Sha256Ctx() { memcpy(state, SHA256_IV, sizeof(state)); }
+
+    void update(const void* data, size_t len) {
+        const auto* p = static_cast<const uint8_t*>(data);
+        total += len;
+        if (bufLen) {
+            size_t take = min(len, 64 - bufLen);
+            memcpy(buf + bufLen, p, take);
+            bufLen += take; p += take; len -= take;
+            if (bufLen < 64) return;
+            sha256Impl().compress(state, buf, 1);
+            bufLen = 0;
+        }
+        if (len >= 64) {
+            sha256Impl().compress(state, p, len / 64);
+            p += len & ~size_t(63);
+            len &= 63;
+        }
+        memcpy(buf, p, len);
+        bufLen = len;
+    }
+
+    Hash256 finish() {
+        uint8_t tail[128] = {};
+        memcpy(tail, buf, bufLen);
+        tail[bufLen] = 0x80;
+        const size_t tailBlocks = bufLen + 9 > 64 ? 2 : 1;
+        const uint64_t bits = total * 8;
+        for (int k = 0; k < 8; ++k) tail[tailBlocks * 64 - 1 - k] = uint8_t(bits >> (8 * k));
+        sha256Impl().compress(state, tail, tailBlocks);
+        Hash256 out;
+        for (int i = 0; i < 8; ++i) storeBE32(out.data() + 4 * i, state[i]);
+        return out;
+    }
+};
+
+// ---------- Helpers ----------
+static string toHex(const uint8_t* p, size_t n) {
+    static const char digits[] = "0123456789abcdef";
+    string s(2 * n, '0');
+    for (size_t i = 0; i < n; ++i) {
+        s[2 * i] = digits[p[i] >> 4];
+        s[2 * i + 1] = digits[p[i] & 0xF];
+    }
+    return s;
+}
+
+static string toHex(const Hash256& h) { return toHex(h.data(), h.size()); }
+
+// Decode exactly n bytes of hex.
+static bool parseHex(string_view s, uint8_t* out, size_t n) {
+    if (s.size() != 2 * n) return false;
+    auto nibble = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    };
+    for (size_t i = 0; i < n; ++i) {
+        int hi = nibble(s[2 * i]), lo = nibble(s[2 * i + 1]);
+        if (hi < 0 || lo < 0) return false;
+        out[i] = uint8_t(hi << 4 | lo);
+    }
+    return true;
+}
+
+static bool parseHex(const string& s, Hash256& out) { return parseHex(s, out.data(), out.size()); }
+
+// Run f(lo, hi) over [0, n) split across hardware threads; inline when n is small.
+template <typename F>
+static void parallelFor(size_t n, size_t grain, F&& f) {
+    size_t threads = min<size_t>(max(1u, thread::hardware_concurrency()), n / max<size_t>(grain, 1));
+    if (threads <= 1) {
+        f(size_t(0), n);
+        return;
+    }
+    vector<thread> pool;
+    size_t per = (n + threads - 1) / threads;
+    for (size_t t = 1; t < threads; ++t) {
+        size_t lo = t * per, hi = min(n, lo + per);
+        if (lo < hi) pool.emplace_back([&f, lo, hi] { f(lo, hi); });
+    }
+    f(size_t(0), min(n, per));
+    for (auto& th : pool) th.join();
+}
+
+// ---------- Password hashing ----------
+// Passwords are stored as scrypt (RFC 7914) hashes over the SHA-256 above:
+//
+//   scrypt$<log2 N>$<r>$<p>$<salt hex>$<key hex>
+//
+// The default N = 2^14, r = 8 needs 16 MB and tens of milliseconds per guess;
+// --kdf-cost lowers log2 N for bulk test loads. Each hash records its own
+// parameters, so raising the cost later does not invalidate stored hashes.
+struct KdfParams {
+    unsigned logN{14};
+    unsigned r{8};
+    unsigned p{1};
+} kdfParams;
+
+static constexpr size_t KDF_SALT_SIZE = 16;
+static constexpr size_t KDF_KEY_SIZE = 32;
+
+static void randomBytes(void* out, size_t n) {
+    auto* p = static_cast<uint8_t*>(out);
+    while (n) {
+        ssize_t got = getrandom(p, n, 0);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) { // no getrandom: fall back to the library's entropy source
+            random_device rd;
+            for (; n; --n) *p++ = uint8_t(rd());
+            return;
+        }
+        p += got;
+        n -= static_cast<size_t>(got);
+    }
+}
+
+// Compare without an early exit, so timing does not reveal the matching prefix.
+static bool constantTimeEqual(const uint8_t* a, const uint8_t* b, size_t n) {
+    uint8_t diff = 0;
+    for (size_t i = 0; i < n; ++i) diff |= a[i] ^ b[i];
+    return diff == 0;
+}
+
+struct HmacSha256 {
+    Sha256Ctx inner, outer;
+
+    HmacSha256(const void* key, size_t len) {
+        uint8_t k[64] = {}, pad[64];
+        if (len > sizeof(k)) {
+            Hash256 h = sha256(key, len);
+            memcpy(k, h.data(), h.size());
+        } else {
+            memcpy(k, key, len);
+        }
+        for (size_t i = 0; i < 64; ++i) pad[i] = k[i] ^ 0x36;
+        inner.update(pad, 64);
+        for (size_t i = 0; i < 64; ++i) pad[i] = k[i] ^ 0x5c;
+        outer.update(pad, 64);
+    }
+    void update(const void* data, size_t len) { inner.update(data, len); }
+    Hash256 finish() {
+        Hash256 h = inner.finish();
+        outer.update(h.data(), h.size());
+        return outer.finish();
+    }
+};
+
+// PBKDF2-HMAC-SHA256 with one iteration, the only count scrypt uses.
+static void pbkdf2Sha256(string_view password, const uint8_t* salt, size_t saltLen, uint8_t* out, size_t outLen) {
+    const HmacSha256 keyed(password.data(), password.size());
+    for (uint32_t block = 1; outLen; ++block) {
+        HmacSha256 h = keyed;
+        uint8_t counter[4];
+        storeBE32(counter, block);
+        h.update(salt, saltLen);
+        h.update(counter, sizeof(counter));
+        Hash256 t = h.finish();
+        size_t take = min(outLen, t.size());
+        memcpy(out, t.data(), take);
+        out += take;
+        outLen -= take;
+    }
+}
+
+static void salsa20_8(uint32_t b[16]) {
+    auto rotl = [](uint32_t x, int n) { return (x << n) | (x >> (32 - n)); };
+    uint32_t x[16];
+    memcpy(x, b, sizeof(x));
+    for (int i = 0; i < 8; i += 2) {
+        x[4] ^= rotl(x[0] + x[12], 7);   x[8] ^= rotl(x[4] + x[0], 9);
+        x[12] ^= rotl(x[8] + x[4], 13);  x[0] ^= rotl(x[12] + x[8], 18);
+        x[9] ^= rotl(x[5] + x[1], 7);    x[13] ^= rotl(x[9] + x[5], 9);
+        x[1] ^= rotl(x[13] + x[9], 13);  x[5] ^= rotl(x[1] + x[13], 18);
+        x[14] ^= rotl(x[10] + x[6], 7);  x[2] ^= rotl(x[14] + x[10], 9);
+        x[6] ^= rotl(x[2] + x[14], 13);  x[10] ^= rotl(x[6] + x[2], 18);
+        x[3] ^= rotl(x[15] + x[11], 7);  x[7] ^= rotl(x[3] + x[15], 9);
+        x[11] ^= rotl(x[7] + x[3], 13);  x[15] ^= rotl(x[11] + x[7], 18);
+        x[1] ^= rotl(x[0] + x[3], 7);    x[2] ^= rotl(x[1] + x[0], 9);
+        x[3] ^= rotl(x[2] + x[1], 13);   x[0] ^= rotl(x[3] + x[2], 18);
+        x[6] ^= rotl(x[5] + x[4], 7);    x[7] ^= rotl(x[6] + x[5], 9);
+        x[4] ^= rotl(x[7] + x[6], 13);   x[5] ^= rotl(x[4] + x[7], 18);
+        x[11] ^= rotl(x[10] + x[9], 7);  x[8] ^= rotl(x[11] + x[10], 9);
+        x[9] ^= rotl(x[8] + x[11], 13);  x[10] ^= rotl(x[9] + x[8], 18);
+        x[12] ^= rotl(x[15] + x[14], 7); x[13] ^= rotl(x[12] + x[15], 9);
+        x[14] ^= rotl(x[13] + x[12], 13); x[15] ^= rotl(x[14] + x[13], 18);
+    }
+    for (int i = 0; i < 16; ++i) b[i] += x[i];
+}
+
+// BlockMix over 2r 64-byte blocks: even outputs go to the first half of y, odd ones to the second.
+static void scryptBlockMix(const uint32_t* b, uint32_t* y, unsigned r) {
+    uint32_t x[16];
+    memcpy(x, b + (2 * r - 1) * 16, sizeof(x));
+    for (size_t i = 0; i < 2 * r; ++i) {
+        for (int k = 0; k < 16; ++k) x[k] ^= b[i * 16 + k];
+        salsa20_8(x);
+        memcpy(y + ((i & 1) * r + i / 2) * 16, x, sizeof(x));
+    }
+}
+
+// ROMix: fill v with N successive mixes of b, then mix b with N data-dependent entries of v.
+static void scryptROMix(uint32_t* b, unsigned r, uint64_t n, vector<uint32_t>& v) {
+    const size_t words = 32 * r;
+    v.resize(words * (n + 1));
+    uint32_t* y = v.data() + words * n;
+    for (uint64_t i = 0; i < n; ++i) {
+        memcpy(&v[words * i], b, words * 4);
+        scryptBlockMix(&v[words * i], b, r);
+    }
+    for (uint64_t i = 0; i < n; ++i) {
+        const uint64_t j = b[(2 * r - 1) * 16] & (n - 1);
+        for (size_t k = 0; k < words; ++k) y[k] = b[k] ^ v[words * j + k];
+        scryptBlockMix(y, b, r);
+    }
+}
+
+static void scrypt(string_view password, const uint8_t* salt, size_t saltLen, const KdfParams& k,
+                   uint8_t* out, size_t outLen) {
+    STAT_SCOPE(Probe::PasswordHash);
+    const size_t words = 32 * k.r;
+    vector<uint8_t> bytes(4 * words * k.p);
+    pbkdf2Sha256(password, salt, saltLen, bytes.data(), bytes.size());
+    vector<uint32_t> b(words * k.p), v;
+    for (size_t i = 0; i < b.size(); ++i) // scrypt's words are little-endian
+        b[i] = uint32_t(bytes[4 * i]) | uint32_t(bytes[4 * i + 1]) << 8 | uint32_t(bytes[4 * i + 2]) << 16 |
+               uint32_t(bytes[4 * i + 3]) << 24;
+    for (unsigned i = 0; i < k.p; ++i) scryptROMix(&b[words * i], k.r, uint64_t(1) << k.logN, v);
+    for (size_t i = 0; i < b.size(); ++i)
+        for (int s = 0; s < 4; ++s) bytes[4 * i + s] = uint8_t(b[i] >> (8 * s));
+    pbkdf2Sha256(password, bytes.data(), bytes.size(), out, outLen);
+}
+
+static bool isPasswordHash(const string& stored) { return stored.compare(0, 7, "scrypt$") == 0; }
+
+static string hashPassword(string_view password, const KdfParams& k = kdfParams) {
+    uint8_t salt[KDF_SALT_SIZE], key[KDF_KEY_SIZE];
+    randomBytes(salt, sizeof(salt));
+    scrypt(password, salt, sizeof(salt), k, key, sizeof(key));
+    return "scrypt$" + to_string(k.logN) + '$' + to_string(k.r) + '$' + to_string(k.p) + '$' +
+           toHex(salt, sizeof(salt)) + '$' + toHex(key, sizeof(key));
+}
+
+// Recompute the stored hash from `password`; malformed or out-of-range entries never match.
+static bool verifyPassword(const string& stored, string_view password) {
+    if (!isPasswordHash(stored)) return false;
+    vector<string_view> f;
+    for (size_t pos = 7;;) {
+        size_t d = stored.find('$', pos);
+        f.push_back(string_view(stored).substr(pos, d == string::npos ? string::npos : d - pos));
+        if (d == string::npos) break;
+        pos = d + 1;
+    }
+    KdfParams k;
+    uint8_t salt[KDF_SALT_SIZE], key[KDF_KEY_SIZE], got[KDF_KEY_SIZE];
+    if (f.size() != 5 || from_chars(f[0].data(), f[0].data() + f[0].size(), k.logN).ec != errc() ||
+        from_chars(f[1].data(), f[1].data() + f[1].size(), k.r).ec != errc() ||
+        from_chars(f[2].data(), f[2].data() + f[2].size(), k.p).ec != errc() ||
+        !parseHex(f[3], salt, sizeof(salt)) || !parseHex(f[4], key, sizeof(key)))
+        return false;
+    if (k.logN < 1 || k.logN > 24 || k.r < 1 || k.r > 32 || k.p < 1 || k.p > 16) return false;
+    scrypt(password, salt, sizeof(salt), k, got, sizeof(got));
+    return constantTimeEqual(got, key, sizeof(key));
+}
+
+// ---------- Merkle trees ----------
+// leaf = SHA-256(0x00 | tx data), node = SHA-256(0x01 | left | right); the odd
+// node at the end of a level is carried up unchanged. Large batches hash
+// leaves and each level across threads; nodes go through sha256Batch.
+static constexpr size_t MERKLE_PARALLEL_MIN = 4096; // leaves per thread before going parallel
+static constexpr size_t MERKLE_NODE_SIZE = 65;
+
+static Hash256 merkleLeaf(string_view data) {
+    Sha256Ctx ctx;
+    const uint8_t prefix = 0x00;
+    ctx.update(&prefix, 1);
+    ctx.update(data.data(), data.size());
+    return ctx.finish();
+}
+
+static void merkleNodeMessage(const Hash256& left, const Hash256& right, uint8_t out[MERKLE_NODE_SIZE]) {
+    out[0] = 0x01;
+    memcpy(out + 1, left.data(), 32);
+    memcpy(out + 33, right.data(), 32);
+}
+
+static Hash256 merkleNode(const Hash256& left, const Hash256& right) {
+    uint8_t msg[MERKLE_NODE_SIZE];
+    merkleNodeMessage(left, right, msg);
+    return sha256(msg, sizeof(msg));
+}
+
+// Hash level[0..n) into its parent level; returns the parent count.
+static size_t merkleReduce(const vector<Hash256>& level, size_t n, vector<Hash256>& parent) {
+    const size_t pairs = n / 2;
+    parallelFor(pairs, MERKLE_PARALLEL_MIN, [&](size_t lo, size_t hi) {
+        constexpr size_t LANES = 8;
+        uint8_t msgs[LANES][MERKLE_NODE_SIZE];
+        const uint8_t* ptrs[LANES];
+        Hash256 out[LANES];
+        for (size_t k = 0; k < LANES; ++k) ptrs[k] = msgs[k];
+        for (size_t base = lo; base < hi; base += LANES) {
+            size_t m = min(LANES, hi - base);
+            for (size_t k = 0; k < m; ++k) merkleNodeMessage(level[2 * (base + k)], level[2 * (base + k) + 1], msgs[k]);
+            sha256Batch(ptrs, MERKLE_NODE_SIZE, out, m);
+            for (size_t k = 0; k < m; ++k) parent[base + k] = out[k];
+        }
+    });
+    if (n & 1) parent[pairs] = level[n - 1];
+    return pairs + (n & 1);
+}
+
+static void merkleLeaves(const BlockStore& store, uint64_t firstTx, uint64_t count, vector<Hash256>& level) {
+    level.resize(count);
+    parallelFor(count, MERKLE_PARALLEL_MIN, [&](size_t lo, size_t hi) {
+        for (size_t i = lo; i < hi; ++i) level[i] = merkleLeaf(store.tx(firstTx + i));
+    });
+}
+
+static Hash256 merkleRoot(const BlockStore& store, uint64_t firstTx, uint64_t count) {
+    STAT_SCOPE(Probe::MerkleRoot);
+    if (!count) return Hash256{};
+    vector<Hash256> level, parent((count + 1) / 2);
+    merkleLeaves(store, firstTx, count, level);
+    for (size_t n = count; n > 1;) {
+        n = merkleReduce(level, n, parent);
+        swap(level, parent);
+    }
+    return level[0];
+}
+
+// Sibling hashes from leaf `pos` up to the root, skipping levels where the
+// node is carried up without a sibling.
+static vector<Hash256> merklePath(const BlockStore& store, uint64_t firstTx, uint64_t count, uint64_t pos) {
+    vector<Hash256> level, parent((count + 1) / 2), path;
+    merkleLeaves(store, firstTx, count, level);
+    for (size_t n = count; n > 1; pos /= 2) {
+        if ((pos ^ 1) < n) path.push_back(level[pos ^ 1]);
+        n = merkleReduce(level, n, parent);
+        swap(level, parent);
+    }
+    return path;
+}
+
+// Fold a path back up to the root. The shape comes from (pos, count), so
+// the path carries no left/right flags; false if its length does not fit.
+static bool merkleRootFromPath(Hash256 node, uint64_t pos, uint64_t count, const vector<Hash256>& path, Hash256& root) {
+    size_t k = 0;
+    for (uint64_t n = count; n > 1; pos /= 2, n = (n + 1) / 2) {
+        if ((pos ^ 1) >= n) continue;
+        if (k == path.size()) return false;
+        node = pos & 1 ? merkleNode(path[k], node) : merkleNode(node, path[k]);
+        ++k;
+    }
+    root = node;
+    return k == path.size();
+}
+
+// ---------- Block hashing ----------
+// The block hash is SHA-256 over a fixed 96-byte header:
+//   index | timestamp | firstTx | txCount (u64 LE each) | previousHash (32) | merkleRoot (32)
+// so every block commits to its position, time, transactions and predecessor.
+static constexpr size_t BLOCK_HEADER_SIZE = 96;
+
+static inline void storeLE64(uint8_t* p, uint64_t v) {
+    for (int k = 0; k < 8; ++k) p[k] = uint8_t(v >> (8 * k));
+}
+
+static void serializeBlockHeader(const Block& b, uint8_t out[BLOCK_HEADER_SIZE]) {
+    storeLE64(out, static_cast<uint64_t>(b.index));
+    storeLE64(out + 8, static_cast<uint64_t>(b.timestamp));
+    storeLE64(out + 16, b.firstTx);
+    storeLE64(out + 24, b.txCount);
+    memcpy(out + 32, b.previousHash.data(), 32);
+    memcpy(out + 64, b.merkleRoot.data(), 32);
+}
+
+static Hash256 computeHash(const Block& b) {
+    STAT_SCOPE(Probe::BlockHash);
+    uint8_t header[BLOCK_HEADER_SIZE];
+    serializeBlockHeader(b, header);
+    return sha256(header, sizeof(header));
+}
+
+// Queue a transaction for the next block; returns its transaction number.
+static uint64_t addTransaction(string data) {
+    STAT_SCOPE(Probe::AddTransaction);
+    BlockStore& store = blockchain.blocks;
+    if (store.txCount() == store.sealedTxCount()) blockchain.pendingSince = chrono::steady_clock::now();
+    return store.appendTx(std::move(data));
+}
+
+// Seal every pending transaction into a new block; returns false if none were pending.
+static bool sealPendingBlock() {
+    STAT_SCOPE(Probe::SealBlock);
+    BlockStore& store = blockchain.blocks;
+    const Block* tail = store.back();
+    Block b;
+    b.firstTx = store.sealedTxCount();
+    b.txCount = store.txCount() - b.firstTx;
+    if (!b.txCount) return false;
+    b.index = static_cast<int64_t>(store.size());
+    b.timestamp = static_cast<int64_t>(time(nullptr));
+    b.previousHash = tail ? tail->hash : Hash256{};
+    b.merkleRoot = merkleRoot(store, b.firstTx, b.txCount);
+    b.hash = computeHash(b);
+    store.append() = b;
+    return true;
+}
+
+// ---------- Transaction records ----------
+// Transactions are stored, hashed and journaled as a fixed little-endian layout:
+//
+//   0  u8   TX_RECORD_TAG     8  i64  amount
+//   1  u8   kind             16  i64  balance    (the `from` account's, after)
+//   2  u16  fromLen          24  i64  toBalance  (transfer destination's, after)
+//   4  u16  toLen            32  from, then to   (account numbers)
+//   6  u16  0
+//
+// An opening record carries the holder's name in `to`. Text is rendered only
+// for display and export. The tag byte never starts a text transaction, so
+// ledgers recorded as text before this format are read and shown as they are.
+enum class TxKind : uint8_t { Open = 1, Deposit, Withdraw, Transfer };
+
+static constexpr uint8_t TX_RECORD_TAG = 0x01;
+static constexpr size_t TX_RECORD_HEADER = 32;
+
+struct TxRecord {
+    TxKind kind{TxKind::Open};
+    Money amount{0};
+    Money balance{0};
+    Money toBalance{0};
+    string_view from, to;
+};
+
+static void encodeTx(string& out, const TxRecord& t) {
+    uint8_t h[TX_RECORD_HEADER] = {TX_RECORD_TAG, static_cast<uint8_t>(t.kind)};
+    h[2] = uint8_t(t.from.size());
+    h[3] = uint8_t(t.from.size() >> 8);
+    h[4] = uint8_t(t.to.size());
+    h[5] = uint8_t(t.to.size() >> 8);
+    storeLE64(h + 8, static_cast<uint64_t>(t.amount));
+    storeLE64(h + 16, static_cast<uint64_t>(t.balance));
+    storeLE64(h + 24, static_cast<uint64_t>(t.toBalance));
+    out.reserve(out.size() + sizeof(h) + t.from.size() + t.to.size());
+    out.append(reinterpret_cast<const char*>(h), sizeof(h));
+    out += t.from;
+    out += t.to;
+}
+
+// Parses a record; false for text transactions and malformed records.
+// `from` and `to` point into data.
+static bool decodeTx(string_view data, TxRecord& t) {
+    if (data.size() < TX_RECORD_HEADER || uint8_t(data[0]) != TX_RECORD_TAG) return false;
+    const auto* p = reinterpret_cast<const uint8_t*>(data.data());
+    if (p[1] < uint8_t(TxKind::Open) || p[1] > uint8_t(TxKind::Transfer)) return false;
+    size_t fromLen = p[2] | size_t(p[3]) << 8, toLen = p[4] | size_t(p[5]) << 8;
+    if (TX_RECORD_HEADER + fromLen + toLen != data.size()) return false;
+    auto i64 = [&](size_t at) {
+        uint64_t v = 0;
+        for (int k = 0; k < 8; ++k) v |= uint64_t(p[at + k]) << (8 * k);
+        return static_cast<Money>(v);
+    };
+    t.kind = static_cast<TxKind>(p[1]);
+    t.amount = i64(8);
+    t.balance = i64(16);
+    t.toBalance = i64(24);
+    t.from = data.substr(TX_RECORD_HEADER, fromLen);
+    t.to = data.substr(TX_RECORD_HEADER + fromLen, toLen);
+    return true;
+}
+
+// Append the display text of a transaction (text transactions as stored).
+static void appendTxText(string& out, string_view data) {
+    TxRecord t;
+    if (!decodeTx(data, t)) {
+        out += data;
+        return;
+    }
+    switch (t.kind) {
+        case TxKind::Open:
+            out += "Created account for ";
+            out += t.to;
+            out += " with initial deposit of Rs.";
+            appendMoney(out, t.amount);
+            out += ". Account Number: ";
+            out += t.from;
+            break;
+        case TxKind::Deposit:
+        case TxKind::Withdraw:
+            out += t.kind == TxKind::Deposit ? "Deposited Rs." : "Withdrawn Rs.";
+            appendMoney(out, t.amount);
+            out += t.kind == TxKind::Deposit ? " to " : " from ";
+            out += t.from;
+            out += ". New Balance: Rs.";
+            appendMoney(out, t.balance);
+            break;
+        case TxKind::Transfer:
+            out += "Transferred Rs.";
+            appendMoney(out, t.amount);
+            out += " from ";
+            out += t.from;
+            out += " to ";
+            out += t.to;
+            break;
+    }
+}
+
+static string txText(string_view data) {
+    string s;
+    appendTxText(s, data);
+    return s;
+}
+
+static void initBankDatabase(BankDatabase* db) {
+    db->storage.clear();
+    db->accounts.clear();
+    db->accountsSorted = true;
+    db->nextAccountNumber = 1;
+    db->index = AccountIndex();
+}
+
+// Account numbers share a prefix and differ in zero-padded digits that can
+// outgrow the padding, so shorter numbers sort first.
+static bool accountLess(const string& a, const string& b) {
+    return a.size() != b.size() ? a.size() < b.size() : a < b;
+}
+
+// Visit accounts [first, first + limit) in account-number order.
+template <typename F>
+static void forEachAccount(BankDatabase* db, F&& f, size_t first = 0, size_t limit = SIZE_MAX) {
+    if (!db->accountsSorted) {
+        sort(db->accounts.begin(), db->accounts.end(),
+             [](const User* a, const User* b) { return accountLess(a->accountNumber, b->accountNumber); });
+        db->accountsSorted = true;
+    }
+    size_t last = first + min(limit, db->accounts.size() - min(first, db->accounts.size()));
+    for (size_t i = first; i < last; ++i) f(*db->accounts[i]);
+}
+
+static User* findUser(BankDatabase* db, const string& accountNumber) {
+    STAT_SCOPE(Probe::FindUser);
+    User* u = db->index.find(accountNumber);
+    if (!u) STAT_COUNT(Counter::FindUserMiss);
+    return u;
+}
+
+// Creates a user with the next account number, or with `accountNumber` when
+// restoring a saved account (nextAccountNumber then moves past it).
+// Returns nullptr if the account number is already taken.
+static User* createUser(BankDatabase* db, const string& name, const string& mobile,
+                        const string& passwordHash, Money initialDeposit, const string& accountNumber = "") {
+    if (!accountNumber.empty() && findUser(db, accountNumber)) return nullptr;
+    User* newUser = &db->storage.emplace_back();
+
+    if (accountNumber.empty()) {
+        ostringstream acc;
+        acc << "CSAGRP6A" << setw(3) << setfill('0') << db->nextAccountNumber++;
+        newUser->accountNumber = acc.str();
+    } else {
+        newUser->accountNumber = accountNumber;
+        size_t digits = accountNumber.find_last_not_of("0123456789") + 1;
+        if (digits < accountNumber.size() && accountNumber.size() - digits < 10)
+            db->nextAccountNumber = max(db->nextAccountNumber, stoi(accountNumber.substr(digits)) + 1);
+    }
+    newUser->name = name;
+    newUser->mobile = mobile;
+    newUser->passwordHash = passwordHash;
+    newUser->balance = initialDeposit;
+
+    if (!db->accounts.empty() && accountLess(newUser->accountNumber, db->accounts.back()->accountNumber))
+        db->accountsSorted = false;
+    db->accounts.push_back(newUser);
+    db->index.insertUnique(newUser);
+    return newUser;
+}
+
+// Large-buffer writer over a raw descriptor so whole files stream out in few syscalls.
+struct BufferedWriter {
+    static constexpr size_t CAPACITY = 1 << 20;
+    int fd{-1};
+    string buf;
+    bool ok{true};
+
+    explicit BufferedWriter(int f) : fd(f) { buf.reserve(CAPACITY); }
+
+    void flush() {
+        const char* p = buf.data();
+        size_t left = buf.size();
+        while (ok && left) {
+            ssize_t n = ::write(fd, p, left);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) ok = false;
+            else { p += n; left -= static_cast<size_t>(n); }
+        }
+        buf.clear();
+    }
+    void write(const void* data, size_t len) {
+        if (buf.size() + len > CAPACITY) flush();
+        if (len >= CAPACITY) {
+            buf.assign(static_cast<const char*>(data), len);
+            flush();
+        } else {
+            buf.append(static_cast<const char*>(data), len);
+        }
+    }
+    void write(string_view s) { write(s.data(), s.size()); }
+};
+
+// ---------- CSV I/O ----------
+// Readers mmap the file, cut it into row-aligned chunks and parse them in
+// parallel; fields are views into the mapping. Fields may be quoted as in
+// RFC 4180, so commas, newlines and doubled quotes inside quotes are data.
+// Writers quote exactly the fields that need it.
+struct MappedFile {
+    const char* data{nullptr};
+    size_t size{0};
+    bool ok{false};
+
+    explicit MappedFile(const string& path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st {};
+        ok = fstat(fd, &st) == 0;
+        size = ok ? static_cast<size_t>(st.st_size) : 0;
+        if (size) {
+            void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map == MAP_FAILED) {
+                ok = false;
+                size = 0;
+            } else {
+                data = static_cast<const char*>(map);
+                if (madvise(map, size, MADV_SEQUENTIAL) != 0) { /* advisory only */ }
+            }
+        }
+        close(fd);
+    }
+    ~MappedFile() {
+        if (data) munmap(const_cast<char*>(data), size);
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    const char* end() const { return data + size; }
+};
+
+struct CsvField {
+    string_view text;     // between the quotes when quoted
+    bool escaped{false};  // text holds doubled quotes
+
+    string str() const {
+        if (!escaped) return string(text);
+        string s;
+        s.reserve(text.size());
+        for (size_t i = 0; i < text.size(); ++i) {
+            s += text[i];
+            if (text[i] == '"' && i + 1 < text.size() && text[i + 1] == '"') ++i;
+        }
+        return s;
+    }
+};
+
+// First ',' or '\n' in [p, end), or end; 16 bytes per step with SSE2.
+static const char* findFieldEnd(const char* p, const char* end) {
+#ifdef __SSE2__
+    const __m128i comma = _mm_set1_epi8(','), newline = _mm_set1_epi8('\n');
+    for (; end - p >= 16; p += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        int m = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(bytes, comma), _mm_cmpeq_epi8(bytes, newline)));
+        if (m) return p + __builtin_ctz(static_cast<unsigned>(m));
+    }
+#endif
+    while (p < end && *p != ',' && *p != '\n') ++p;
+    return p;
+}
+
+// Parse the row at p into up to maxFields fields; `n` gets the number found
+// (which may exceed maxFields). Returns the start of the next row.
+static const char* parseCsvRow(const char* p, const char* end, CsvField* fields, size_t maxFields, size_t& n) {
+    n = 0;
+    for (;;) {
+        CsvField f;
+        if (p < end && *p == '"') {
+            const char* s = ++p;
+            for (;;) {
+                const char* q = static_cast<const char*>(memchr(p, '"', static_cast<size_t>(end - p)));
+                if (!q) { // unterminated: the rest of the file is the field
+                    f.text = string_view(s, static_cast<size_t>(end - s));
+                    p = end;
+                    break;
+                }
+                if (q + 1 < end && q[1] == '"') {
+                    f.escaped = true;
+                    p = q + 2;
+                    continue;
+                }
+                f.text = string_view(s, static_cast<size_t>(q - s));
+                p = q + 1;
+                break;
+            }
+            p = findFieldEnd(p, end); // skip stray bytes after the closing quote
+        } else {
+            const char* s = p;
+            p = findFieldEnd(p, end);
+            f.text = string_view(s, static_cast<size_t>(p - s));
+            if (!f.text.empty() && f.text.back() == '\r' && (p == end || *p == '\n')) f.text.remove_suffix(1);
+        }
+        if (n < maxFields) fields[n] = f;
+        ++n;
+        if (p < end && *p == ',') {
+            ++p;
+            continue;
+        }
+        return p < end ? p + 1 : end;
+    }
+}
+
+// Cut [begin, end) into about `parts` ranges that each start a row. A cut
+// moves to the first newline outside quotes, found from the quote parity of
+// the bytes before it (counted in parallel).
+static vector<const char*> csvChunks(const char* begin, const char* end, size_t parts) {
+    vector<const char*> cuts{begin};
+    const size_t step = parts > 1 ? static_cast<size_t>(end - begin) / parts : 0;
+    if (step) {
+        vector<size_t> quotes(parts);
+        parallelFor(parts, 1, [&](size_t lo, size_t hi) {
+            for (size_t i = lo; i < hi; ++i) quotes[i] = static_cast<size_t>(count(begin + i * step, begin + (i + 1) * step, '"'));
+        });
+        size_t parity = 0;
+        for (size_t i = 1; i < parts; ++i) {
+            parity += quotes[i - 1];
+            const char* p = begin + i * step;
+            for (bool quoted = parity & 1; p < end && (quoted || *p != '\n'); ++p)
+                if (*p == '"') quoted = !quoted;
+            p = p < end ? p + 1 : end;
+            if (p > cuts.back() && p < end) cuts.push_back(p);
+        }
+    }
+    cuts.push_back(end);
+    return cuts;
+}
+
+// Parse every row after the header in parallel chunks: toRow(fields, n, row)
+// fills a Row from each non-blank line and returns false to skip it. Rows come
+// back grouped by chunk, in file order.
+template <size_t FIELDS, typename Row, typename F>
+static vector<vector<Row>> parseCsv(const MappedFile& file, F&& toRow) {
+    constexpr size_t CHUNK_BYTES = 4 << 20;
+    if (!file.size) return {};
+    CsvField header[FIELDS];
+    size_t n;
+    const char* body = parseCsvRow(file.data, file.end(), header, FIELDS, n);
+    size_t parts = max<size_t>(1, static_cast<size_t>(file.end() - body) / CHUNK_BYTES);
+    vector<const char*> cuts = csvChunks(body, file.end(), parts);
+    vector<vector<Row>> rows(cuts.size() - 1);
+    parallelFor(rows.size(), 1, [&](size_t lo, size_t hi) {
+        CsvField fields[FIELDS];
+        size_t found;
+        for (size_t c = lo; c < hi; ++c) {
+            rows[c].reserve(static_cast<size_t>(cuts[c + 1] - cuts[c]) / 64);
+            for (const char* p = cuts[c]; p < cuts[c + 1];) {
+                const char* line = p;
+                p = parseCsvRow(p, cuts[c + 1], fields, FIELDS, found);
+                if (found == 1 && fields[0].text.empty() && *line != '"') continue; // blank line
+                if (!toRow(fields, found, rows[c].emplace_back())) rows[c].pop_back();
+            }
+        }
+    });
+    return rows;
+}
+
+template <typename T>
+static bool parseInt(string_view s, T& out) {
+    auto r = from_chars(s.data(), s.data() + s.size(), out);
+    return r.ec == errc() && r.ptr == s.data() + s.size();
+}
+
+// Append one field, quoted only if it holds a comma, quote or line break.
+static void appendCsvField(string& out, string_view s) {
+    if (s.find_first_of(",\"\r\n") == string_view::npos) {
+        out += s;
+        return;
+    }
+    out += '"';
+    for (char c : s) {
+        if (c == '"') out += '"';
+        out += c;
+    }
+    out += '"';
+}
+
+// Streams the account table through a 1 MB buffer into a temp file, then renames it over `filename`.
+static void saveUsersToCSV(BankDatabase* db, const string& filename) {
+    STAT_SCOPE(Probe::SaveUsers);
+    const string tmp = filename + ".tmp";
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        cerr << "Failed to open file: " << tmp << "\n";
+        return;
+    }
+    BufferedWriter out(fd);
+    out.write("AccountNumber,Name,Mobile,PasswordHash,Balance\n");
+    string row;
+    forEachAccount(db, [&](const User& u) {
+        row.clear();
+        appendCsvField(row, u.accountNumber);
+        row += ',';
+        appendCsvField(row, u.name);
+        row += ',';
+        appendCsvField(row, u.mobile);
+        row += ',';
+        appendCsvField(row, u.passwordHash);
+        row += ',';
+        appendMoney(row, u.balance);
+        row += '\n';
+        out.write(row);
+    });
+    out.flush();
+    bool ok = out.ok && fsync(fd) == 0;
+    close(fd);
+    if (!ok || rename(tmp.c_str(), filename.c_str()) != 0) {
+        cerr << "Failed to write file: " << filename << "\n";
+        unlink(tmp.c_str());
+    }
+}
+
+static void ensureUsersCSVExists(const string& filename) {
+    ifstream fin(filename);
+    if (fin.good()) return;
+    ofstream fout(filename);
+    if (!fout) {
+        cerr << "Failed to create file: " << filename << "\n";
+        return;
+    }
+    fout << "AccountNumber,Name,Mobile,PasswordHash,Balance\n";
+    cerr << "New file created: " << filename << "\n";
+}
+
+static void loadUsersFromCSV(BankDatabase* db, const string& filename) {
+    STAT_SCOPE(Probe::LoadUsers);
+    ensureUsersCSVExists(filename);
+    MappedFile file(filename);
+    if (!file.ok) {
+        cerr << "Failed to open file: " << filename << "\n";
+        return;
+    }
+    struct Row {
+        CsvField accountNumber, name, mobile, passwordHash, balanceText;
+        Money balance;
+        bool valid;
+    };
+    auto rows = parseCsv<5, Row>(file, [](const CsvField* f, size_t n, Row& r) {
+        if (n < 5) return false;
+        r = Row{f[0], f[1], f[2], f[3], f[4], 0, false};
+        r.valid = parseMoney(f[4].text, r.balance);
+        return true;
+    });
+    size_t total = 0;
+    for (const auto& chunk : rows) total += chunk.size();
+    // Size the account index once from the row count instead of growing it row by row.
+    db->index.reserve(db->index.size() + total);
+    for (const auto& chunk : rows)
+        for (const Row& r : chunk) {
+            string accountNumber = r.accountNumber.str();
+            if (!r.valid) {
+                cerr << "Skipping account " << accountNumber << " with invalid balance " << r.balanceText.str() << "\n";
+                continue;
+            }
+            if (!createUser(db, r.name.str(), r.mobile.str(), r.passwordHash.str(), r.balance, accountNumber))
+                cerr << "Skipping duplicate account " << accountNumber << " in " << filename << "\n";
+        }
+}
+
+// One row per transaction; block fields (Index, PreviousHash, Timestamp, Hash)
+// repeat on every row of the block, and a block's rows are consecutive. Data
+// is the display text; Payload is the hex of a transaction record (empty for
+// text transactions), which is what the block hashes cover.
+// Written to a temporary file and renamed over `filename`, like the other writers.
+static bool saveTransactionsToCSV(const string& filename) {
+    STAT_SCOPE(Probe::SaveTransactions);
+    const string tmp = filename + ".tmp";
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        cerr << "Failed to open file: " << tmp << "\n";
+        return false;
+    }
+    BufferedWriter out(fd);
+    out.write("Index,TransactionID,PreviousHash,Timestamp,Data,Hash,Payload\n");
+    const BlockStore& store = blockchain.blocks;
+    string row, text;
+    store.forEach([&](const Block& b) {
+        const string prev = toHex(b.previousHash), hash = toHex(b.hash);
+        store.forEachTx(b, [&](uint64_t n, string_view data) {
+            TxRecord t;
+            const bool record = decodeTx(data, t);
+            row.clear();
+            row += to_string(b.index);
+            row += ',';
+            row += transactionID(n);
+            row += ',';
+            row += prev;
+            row += ',';
+            row += to_string(static_cast<long long>(b.timestamp));
+            row += ',';
+            if (record) {
+                text.clear();
+                appendTxText(text, data);
+                appendCsvField(row, text);
+            } else {
+                appendCsvField(row, data);
+            }
+            row += ',';
+            row += hash;
+            row += ',';
+            if (record) row += toHex(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+            row += '\n';
+            out.write(row);
+        });
+    });
+    out.flush();
+    bool ok = out.ok && fsync(fd) == 0;
+    close(fd);
+    if (!ok || rename(tmp.c_str(), filename.c_str()) != 0) {
+        cerr << "Failed to write file: " << filename << "\n";
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+static void ensureTxCSVExists(const string& filename) {
+    ifstream fin(filename);
+    if (fin.good()) return;
+    ofstream fout(filename);
+    if (!fout) {
+        cerr << "Failed to create file: " << filename << "\n";
+        return;
+    }
+    fout << "Index,TransactionID,PreviousHash,Timestamp,Data,Hash,Payload\n";
+    cerr << "New transactions file created: " << filename << "\n";
+}
+
+// How loadTransactionsFromCSV treats rows that do not form a SHA-256 chain.
+enum class CsvLoad : uint8_t {
+    AsStored, // keep every block as written and report the first defect (audits, queries)
+    Reseal,   // renumber a legacy (djb2) ledger and seal it into a new chain (conversions)
+};
+
+// First block of a CSV ledger that could not be loaded as written; -1 if none.
+struct CsvDefect {
+    long long block{-1};
+    string reason;
+};
+
+// Appends the CSV ledger to an empty block store. Consecutive rows with the
+// same Index form one block. Rows are parsed and their data copied out in
+// parallel; blocks are then formed in file order. A row's Payload, when
+// present, is the stored transaction and Data is only its rendering; files
+// without the column hold text transactions. Returns false if the file
+// cannot be opened; the file is never created or changed.
+static bool loadTransactionsFromCSV(const string& filename, CsvLoad mode, CsvDefect* defect = nullptr) {
+    STAT_SCOPE(Probe::LoadTransactions);
+    MappedFile file(filename);
+    if (!file.ok) {
+        cerr << "Failed to open file: " << filename << "\n";
+        return false;
+    }
+    struct Row {
+        int64_t index, timestamp;
+        string_view id, previousHash, hash;
+        string data;
+        bool valid;
+    };
+    auto rows = parseCsv<7, Row>(file, [](const CsvField* f, size_t n, Row& r) {
+        r.valid = n >= 6 && parseInt(f[0].text, r.index) && parseInt(f[3].text, r.timestamp);
+        if (!r.valid) return true;
+        r.id = f[1].text;
+        r.previousHash = f[2].text;
+        r.hash = f[5].text;
+        if (n < 7 || f[6].text.empty()) {
+            r.data = f[4].str();
+            return true;
+        }
+        TxRecord t;
+        r.data.assign(f[6].text.size() / 2, '\0');
+        r.valid = parseHex(f[6].text, reinterpret_cast<uint8_t*>(r.data.data()), r.data.size()) && decodeTx(r.data, t);
+        return true;
+    });
+
+    BlockStore& store = blockchain.blocks;
+    CsvDefect found;
+    auto note = [&](size_t block, string reason) {
+        if (found.block < 0) found = {static_cast<long long>(block), std::move(reason)};
+    };
+    // Blocks are appended to the store in the order found (assumed already chronological)
+    bool legacy = false;
+    size_t rowNo = 0, skipped = 0;
+    vector<int64_t> rowTimes; // per-transaction timestamps, kept for legacy migration
+    for (auto& chunk : rows) {
+        for (Row& r : chunk) {
+            ++rowNo;
+            if (!r.valid) {
+                note(store.size(), "row " + to_string(rowNo) + " is malformed");
+                ++skipped;
+                continue;
+            }
+            if (r.id != transactionID(store.txCount()))
+                note(store.size(), "row " + to_string(rowNo) + " holds " + string(r.id) + " where " +
+                                       transactionID(store.txCount()) + " belongs");
+            rowTimes.push_back(r.timestamp);
+            Block* b = store.empty() ? nullptr : &store.appended(store.size() - 1);
+            if (legacy || !b || b->index != r.index) {
+                b = &store.append();
+                b->index = r.index;
+                b->timestamp = r.timestamp;
+                b->firstTx = store.txCount();
+                if (!parseHex(r.previousHash, b->previousHash.data(), b->previousHash.size()) ||
+                    !parseHex(r.hash, b->hash.data(), b->hash.size())) {
+                    note(store.size() - 1, "stored hash is not 64 hex digits");
+                    legacy = true;
+                }
+            }
+            store.appendTx(std::move(r.data));
+            ++b->txCount;
+        }
+        vector<Row>().swap(chunk);
+    }
+    if (skipped && mode == CsvLoad::Reseal) cerr << "Skipped " << skipped << " malformed rows in " << filename << "\n";
+    if (defect) *defect = found;
+
+    // Ledgers written before SHA-256 chaining carry decimal djb2 digests and
+    // unreliable indices. A conversion renumbers them in file order (one
+    // transaction per block, as they were written) and seals a new chain;
+    // nothing of the old one is checked, so audits never take this path.
+    if (legacy && mode == CsvLoad::Reseal) {
+        cerr << "Re-sealing legacy ledger " << filename << ": " << store.txCount()
+             << " transactions get new block numbers and SHA-256 hashes; the old djb2 hashes are not checked\n";
+        store.headers = ChunkedArena<Block>();
+        blockchain.timeIndex = TimeIndex();
+        Hash256 prevHash{};
+        for (uint64_t i = 0; i < store.txCount(); ++i) {
+            Block& b = store.append();
+            b.index = static_cast<int64_t>(i);
+            b.timestamp = rowTimes[i];
+            b.firstTx = i;
+            b.txCount = 1;
+            b.previousHash = prevHash;
+            b.merkleRoot = merkleRoot(store, b.firstTx, b.txCount);
+            b.hash = computeHash(b);
+            prevHash = b.hash;
+        }
+    } else {
+        parallelFor(store.size(), 64, [&](size_t lo, size_t hi) {
+            for (size_t i = lo; i < hi; ++i) {
+                Block& b = store.appended(i);
+                b.merkleRoot = merkleRoot(store, b.firstTx, b.txCount);
+            }
+        });
+    }
+    return true;
+}
+
+// ---------- Binary ledger ----------
+// ledger.bin holds the sealed chain in a form that is mmap'd and used in place:
+//
+//   LedgerFileHeader (64 bytes)
+//   Block headers    blockCount x 128 bytes, block N at headersOffset + 128 * N
+//   Tx offsets       (txCount + 1) x u64, data of transaction N is [off[N], off[N + 1])
+//   Payload region   concatenated transaction data
+//
+// All integers are little-endian. Only sealed blocks are written; the file is
+// replaced atomically via rename. Version 1 (one payload per block) is not read.
+static constexpr char LEDGER_MAGIC[8] = {'B', 'C', 'L', 'E', 'D', 'G', 'E', 'R'};
+static constexpr uint32_t LEDGER_VERSION = 2;
+
+struct LedgerFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t blockHeaderSize;
+    uint64_t blockCount;
+    uint64_t txCount;
+    uint64_t headersOffset;
+    uint64_t txOffsetsOffset;
+    uint64_t payloadOffset;
+    uint64_t payloadSize;
+};
+static_assert(sizeof(LedgerFileHeader) == 64, "ledger.bin file header must be 64 bytes");
+
+static bool writeLedger(const string& path) {
+    STAT_SCOPE(Probe::WriteLedger);
+    const BlockStore& store = blockchain.blocks;
+    const string tmp = path + ".tmp";
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        cerr << "Failed to open file: " << tmp << "\n";
+        return false;
+    }
+
+    LedgerFileHeader fh{};
+    memcpy(fh.magic, LEDGER_MAGIC, sizeof(fh.magic));
+    fh.version = LEDGER_VERSION;
+    fh.blockHeaderSize = sizeof(Block);
+    fh.blockCount = store.size();
+    fh.txCount = store.sealedTxCount();
+    fh.headersOffset = sizeof(LedgerFileHeader);
+    fh.txOffsetsOffset = fh.headersOffset + fh.blockCount * sizeof(Block);
+    fh.payloadOffset = fh.txOffsetsOffset + (fh.txCount + 1) * sizeof(uint64_t);
+    for (uint64_t n = 0; n < fh.txCount; ++n) fh.payloadSize += store.tx(n).size();
+
+    BufferedWriter out(fd);
+    out.write(&fh, sizeof(fh));
+    store.forEach([&](const Block& b) { out.write(&b, sizeof(b)); });
+    uint64_t offset = 0;
+    out.write(&offset, sizeof(offset));
+    for (uint64_t n = 0; n < fh.txCount; ++n) {
+        offset += store.tx(n).size();
+        out.write(&offset, sizeof(offset));
+    }
+    for (uint64_t n = 0; n < fh.txCount; ++n) out.write(store.tx(n));
+    out.flush();
+
+    bool ok = out.ok && fsync(fd) == 0;
+    close(fd);
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+        cerr << "Failed to write ledger: " << path << "\n";
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Map ledger.bin and make it the base of the block store; no per-block parsing.
+static bool openLedger(const string& path) {
+    STAT_SCOPE(Probe::OpenLedger);
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st {};
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(LedgerFileHeader)) {
+        close(fd);
+        cerr << "Ledger file too small: " << path << "\n";
+        return false;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void* map = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        cerr << "Failed to map ledger: " << path << "\n";
+        return false;
+    }
+
+    const auto* base = static_cast<const char*>(map);
+    const auto* fh = reinterpret_cast<const LedgerFileHeader*>(base);
+    bool valid = memcmp(fh->magic, LEDGER_MAGIC, sizeof(fh->magic)) == 0 && fh->version == LEDGER_VERSION &&
+                 fh->blockHeaderSize == sizeof(Block) &&
+                 fh->headersOffset == sizeof(LedgerFileHeader) &&
+                 fh->blockCount <= (size - fh->headersOffset) / sizeof(Block) &&
+                 fh->txCount <= size / sizeof(uint64_t) &&
+                 fh->txOffsetsOffset == fh->headersOffset + fh->blockCount * sizeof(Block) &&
+                 fh->payloadOffset == fh->txOffsetsOffset + (fh->txCount + 1) * sizeof(uint64_t) &&
+                 fh->payloadOffset <= size && fh->payloadSize == size - fh->payloadOffset;
+    if (valid) {
+        // tx(n) and every reader of the block ranges trust these, so a damaged
+        // file must fail here: offsets ascend from 0 to the payload size, and
+        // the blocks cover the transactions in order with no gap or overlap.
+        const auto* offsets = reinterpret_cast<const uint64_t*>(base + fh->txOffsetsOffset);
+        const auto* headers = reinterpret_cast<const Block*>(base + fh->headersOffset);
+        valid = offsets[0] == 0 && offsets[fh->txCount] == fh->payloadSize;
+        for (uint64_t n = 0; valid && n < fh->txCount; ++n) valid = offsets[n] <= offsets[n + 1];
+        uint64_t covered = 0;
+        for (uint64_t i = 0; valid && i < fh->blockCount; ++i) {
+            valid = headers[i].firstTx == covered && headers[i].txCount <= fh->txCount - covered;
+            covered += headers[i].txCount;
+        }
+        valid = valid && covered == fh->txCount;
+    }
+    if (!valid) {
+        munmap(map, size);
+        cerr << "Unsupported or corrupt ledger file: " << path << "\n";
+        return false;
+    }
+    if (madvise(map, size, MADV_WILLNEED) != 0) { /* advisory only */ }
+
+    BlockStore& store = blockchain.blocks;
+    store.clear();
+    blockchain.timeIndex = TimeIndex();
+    store.mapping = map;
+    store.mappingSize = size;
+    store.baseHeaders = reinterpret_cast<const Block*>(base + fh->headersOffset);
+    store.baseCount = fh->blockCount;
+    store.baseTxOffsets = reinterpret_cast<const uint64_t*>(base + fh->txOffsetsOffset);
+    store.basePayload = base + fh->payloadOffset;
+    store.baseTxCount = fh->txCount;
+    return true;
+}
+
+// Open ledger.bin, converting the CSV ledger into it the first time.
+static void loadLedger(const string& ledgerFile, const string& csvFile) {
+    if (access(ledgerFile.c_str(), F_OK) != 0) {
+        ensureTxCSVExists(csvFile);
+        loadTransactionsFromCSV(csvFile, CsvLoad::Reseal);
+        if (writeLedger(ledgerFile)) cerr << "Converted " << csvFile << " to " << ledgerFile << "\n";
+        else return; // keep the CSV-loaded chain in memory
+    }
+    if (!openLedger(ledgerFile)) cerr << "Starting with an empty chain.\n";
+}
+
+// ---------- Engine locks ----------
+// Lock order: accounts (shared, or exclusive to create an account), then
+// account stripes in address order. Balance changes happen under the stripe
+// locks; transactions are then numbered and recorded by the commit pipeline.
+struct EngineLocks {
+    static constexpr unsigned STRIPE_BITS = 10;
+    struct alignas(64) Stripe {
+        mutex m;
+    };
+    Stripe stripes[1u << STRIPE_BITS];
+    shared_mutex accounts;
+} engineLocks;
+
+static mutex& stripeFor(const User* u) {
+    uint64_t h = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(u)) * 0x9E3779B97F4A7C15ull;
+    return engineLocks.stripes[h >> (64 - EngineLocks::STRIPE_BITS)].m;
+}
+
+// ---------- Journal ----------
+// Append-only operation log. Each operation appends its transaction and the
+// accounts it touched, and each sealed block appends its header; the log is
+// replayed over ledger.bin and users.csv on startup and folded into them by
+// the explicit export command.
+//
+// Record layout: u32 payload length | u8 type | payload | u32 CRC-32(type + payload)
+enum JournalRecord : uint8_t { JR_TX = 'T', JR_SEAL = 'S', JR_ACCOUNT = 'U', JR_BALANCE = 'A' };
+
+struct Journal {
+    static constexpr size_t SYNC_BATCH = 64;                                // ops per fdatasync
+    static constexpr chrono::milliseconds SYNC_INTERVAL{200};              // or this much time
+    int fd{-1};
+    string path;
+    off_t size{0};                // bytes of whole records in the file
+    atomic<bool> failed{false};   // a write or fdatasync failed: nothing more is written or accepted
+    string pending;               // records built by the sealer, not yet handed off
+    uint64_t committedOps{0};     // operations ended by the sealer
+    size_t unsyncedOps{0};        // written but not yet fdatasync'd
+    chrono::steady_clock::time_point lastSync{};
+} journal;
+
+// CRC-32 (IEEE), eight bytes per step through slicing-by-8 tables.
+static uint32_t crc32(const void* data, size_t len, uint32_t crc = 0) {
+    static const auto table = [] {
+        array<array<uint32_t, 256>, 8> t{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[0][i] = c;
+        }
+        for (uint32_t i = 0; i < 256; ++i)
+            for (int s = 1; s < 8; ++s) t[s][i] = (t[s - 1][i] >> 8) ^ t[0][t[s - 1][i] & 0xFF];
+        return t;
+    }();
+    const auto* p = static_cast<const uint8_t*>(data);
+    crc = ~crc;
+    for (; len >= 8; p += 8, len -= 8) {
+        uint32_t lo = crc ^ (uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24);
+        uint32_t hi = uint32_t(p[4]) | uint32_t(p[5]) << 8 | uint32_t(p[6]) << 16 | uint32_t(p[7]) << 24;
+        crc = table[7][lo & 0xFF] ^ table[6][(lo >> 8) & 0xFF] ^ table[5][(lo >> 16) & 0xFF] ^ table[4][lo >> 24] ^
+              table[3][hi & 0xFF] ^ table[2][(hi >> 8) & 0xFF] ^ table[1][(hi >> 16) & 0xFF] ^ table[0][hi >> 24];
+    }
+    for (; len; --len) crc = table[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static void putU32(string& out, uint32_t v) {
+    char b[4];
+    for (int k = 0; k < 4; ++k) b[k] = char(v >> (8 * k));
+    out.append(b, 4);
+}
+
+static void putI64(string& out, int64_t v) {
+    char b[8];
+    storeLE64(reinterpret_cast<uint8_t*>(b), static_cast<uint64_t>(v));
+    out.append(b, 8);
+}
+
+static void putStr(string& out, const string& s) {
+    putU32(out, static_cast<uint32_t>(s.size()));
+    out += s;
+}
+
+// Bounds-checked little-endian reader over one record payload.
+struct ByteReader {
+    const char* p;
+    const char* end;
+    bool ok{true};
+
+    bool need(size_t n) { return ok = ok && static_cast<size_t>(end - p) >= n; }
+    uint32_t u32() {
+        if (!need(4)) return 0;
+        uint32_t v = 0;
+        for (int k = 0; k < 4; ++k) v |= uint32_t(uint8_t(p[k])) << (8 * k);
+        p += 4;
+        return v;
+    }
+    int64_t i64() {
+        if (!need(8)) return 0;
+        uint64_t v = 0;
+        for (int k = 0; k < 8; ++k) v |= uint64_t(uint8_t(p[k])) << (8 * k);
+        p += 8;
+        return static_cast<int64_t>(v);
+    }
+    string str() {
+        uint32_t n = u32();
+        if (!need(n)) return {};
+        string s(p, n);
+        p += n;
+        return s;
+    }
+    void bytes(void* out, size_t n) {
+        if (!need(n)) return;
+        memcpy(out, p, n);
+        p += n;
+    }
+    // True if everything read so far was there and nothing is left over.
+    bool done() { return ok = ok && p == end; }
+};
+
+static void journalRecord(JournalRecord type, const string& payload) {
+    if (journal.fd < 0 || journal.failed.load(memory_order_relaxed)) return;
+    putU32(journal.pending, static_cast<uint32_t>(payload.size()));
+    size_t body = journal.pending.size();
+    journal.pending += char(type);
+    journal.pending += payload;
+    putU32(journal.pending, crc32(journal.pending.data() + body, payload.size() + 1));
+}
+
+static void journalTx(uint64_t n) {
+    string_view data = blockchain.blocks.tx(n);
+    string p;
+    putI64(p, static_cast<int64_t>(n));
+    putU32(p, static_cast<uint32_t>(data.size()));
+    p.append(data.data(), data.size());
+    journalRecord(JR_TX, p);
+}
+
+static void journalSeal(const Block& b) {
+    journalRecord(JR_SEAL, string(reinterpret_cast<const char*>(&b), sizeof(b)));
+}
+
+static void journalAccount(const User& u, Money balance) {
+    string p;
+    putStr(p, u.accountNumber);
+    putStr(p, u.name);
+    putStr(p, u.mobile);
+    putStr(p, u.passwordHash);
+    putI64(p, balance);
+    journalRecord(JR_ACCOUNT, p);
+}
+
+static void journalBalance(const User& u, Money balance) {
+    string p;
+    putStr(p, u.accountNumber);
+    putI64(p, balance);
+    journalRecord(JR_BALANCE, p);
+}
+
+// Latch the journal as failed. Records after a lost one cannot be replayed
+// safely, so the engine refuses further operations until a restart.
+static void journalFailed(const char* what) {
+    cerr << "Journal " << journal.path << ": " << what << " failed: " << strerror(errno)
+         << "; no further operations are accepted\n";
+    journal.failed.store(true);
+}
+
+// Returns true if it flushed anything.
+static bool journalSync() {
+    if (journal.fd < 0 || !journal.unsyncedOps || journal.failed.load(memory_order_relaxed)) return false;
+    if (fdatasync(journal.fd) != 0) {
+        journalFailed("fdatasync");
+        return false;
+    }
+    journal.unsyncedOps = 0;
+    journal.lastSync = chrono::steady_clock::now();
+    return true;
+}
+
+// End the current operation's records.
+static void journalCommit() {
+    ++journal.committedOps;
+}
+
+// On a failed write the partial batch is cut off again, so the file still
+// ends on a whole record, and the journal is latched as failed.
+static void journalWrite(const string& buf) {
+    if (journal.fd < 0 || journal.failed.load(memory_order_relaxed)) return;
+    const char* p = buf.data();
+    size_t left = buf.size();
+    while (left) {
+        ssize_t n = write(journal.fd, p, left);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            if (n == 0) errno = EIO;
+            journalFailed("write");
+            if (ftruncate(journal.fd, journal.size) != 0)
+                cerr << "Failed to truncate journal: " << strerror(errno) << "\n";
+            return;
+        }
+        p += n;
+        left -= static_cast<size_t>(n);
+    }
+    journal.size += static_cast<off_t>(buf.size());
+}
+
+// Returns false if the record cannot follow the chain as loaded; replay
+// must stop there, since later records would be applied out of place.
+static bool applyJournalRecord(BankDatabase* db, JournalRecord type, ByteReader& r) {
+    // Transactions and blocks already folded into ledger.bin by an interrupted export are skipped.
+    BlockStore& store = blockchain.blocks;
+    if (type == JR_TX) {
+        uint64_t n = static_cast<uint64_t>(r.i64());
+        string data = r.str();
+        if (!r.ok || n < store.txCount()) return true;
+        if (n != store.txCount()) {
+            cerr << "Journal holds " << transactionID(n) << " where " << transactionID(store.txCount())
+                 << " belongs\n";
+            return false;
+        }
+        addTransaction(std::move(data));
+    } else if (type == JR_SEAL) {
+        Block b;
+        r.bytes(&b, sizeof(b));
+        if (!r.ok || b.index < static_cast<int64_t>(store.size())) return true;
+        if (b.firstTx != store.sealedTxCount() || b.firstTx + b.txCount > store.txCount()) {
+            cerr << "Journal seal for block " << b.index << " does not match pending transactions; ignored\n";
+            return true;
+        }
+        store.append() = b; // taken as recorded; --verify rechecks it
+        blockchain.pendingSince = chrono::steady_clock::now();
+    } else if (type == JR_ACCOUNT) {
+        string acc = r.str(), name = r.str(), mobile = r.str(), passwordHash = r.str();
+        Money balance = r.i64();
+        if (!r.done()) return true;
+        if (User* u = findUser(db, acc)) u->balance = balance;
+        else createUser(db, name, mobile, passwordHash, balance, acc);
+    } else if (type == JR_BALANCE) {
+        string acc = r.str();
+        Money balance = r.i64();
+        if (!r.done()) return true;
+        if (User* u = findUser(db, acc)) u->balance = balance;
+    }
+    return true;
+}
+
+// Apply every intact record of the journal at `path`; returns the length of
+// the intact prefix and the file's size. `corrupt` is set if replay stopped
+// at an intact record that does not follow the chain.
+static size_t replayJournal(BankDatabase* db, const string& path, size_t& fileSize, bool& corrupt) {
+    string buf;
+    {
+        ifstream in(path, ios::binary);
+        buf.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    }
+    size_t pos = 0, records = 0;
+    corrupt = false;
+    while (buf.size() - pos >= 9) {
+        uint32_t len = 0;
+        for (int k = 0; k < 4; ++k) len |= uint32_t(uint8_t(buf[pos + k])) << (8 * k);
+        if (buf.size() - pos - 9 < len) break;
+        const char* body = buf.data() + pos + 4;
+        uint32_t stored = 0;
+        for (int k = 0; k < 4; ++k) stored |= uint32_t(uint8_t(body[len + 1 + k])) << (8 * k);
+        if (crc32(body, len + 1) != stored) break;
+        ByteReader r{body + 1, body + 1 + len};
+        if (!applyJournalRecord(db, static_cast<JournalRecord>(body[0]), r)) {
+            corrupt = true;
+            break;
+        }
+        pos += 9 + len;
+        ++records;
+    }
+    if (records) cerr << "Replayed " << records << " journal records from " << path << "\n";
+    fileSize = buf.size();
+    return pos;
+}
+
+// Replay every intact record, drop a torn tail, and keep the file open for appends.
+static void openJournal(BankDatabase* db, const string& path) {
+    STAT_SCOPE(Probe::ReplayJournal);
+    journal.path = path;
+    journal.fd = open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (journal.fd < 0) {
+        journalFailed("open");
+        return;
+    }
+    bool corrupt;
+    size_t fileSize, pos = replayJournal(db, path, fileSize, corrupt);
+    if (corrupt) {
+        // Kept as it is for inspection; appending after it would bury the damage.
+        cerr << "Journal " << path << ": replay stopped at byte " << pos
+             << "; no further operations are accepted\n";
+        journal.failed.store(true);
+    } else if (pos != fileSize) {
+        cerr << "Journal " << path << ": discarding " << fileSize - pos << " bytes of torn tail\n";
+        if (ftruncate(journal.fd, static_cast<off_t>(pos)) != 0)
+            cerr << "Failed to truncate journal: " << strerror(errno) << "\n";
+    }
+    journal.size = static_cast<off_t>(pos);
+    journal.lastSync = chrono::steady_clock::now();
+}
+
+// Replay the journal, if there is one, without opening it for writing; a torn
+// tail is left for the next writer to drop.
+static void readJournal(BankDatabase* db, const string& path) {
+    STAT_SCOPE(Probe::ReplayJournal);
+    if (access(path.c_str(), F_OK) != 0) return;
+    bool corrupt;
+    size_t fileSize, pos = replayJournal(db, path, fileSize, corrupt);
+    if (corrupt) cerr << "Journal " << path << ": replay stopped at byte " << pos << "\n";
+    else if (pos != fileSize) cerr << "Journal " << path << ": ignoring " << fileSize - pos << " bytes of torn tail\n";
+}
+
+// ---------- Sealing ----------
+// Both run on the sealer thread (see the commit pipeline).
+static void sealBlock() {
+    if (!sealPendingBlock()) return;
+    journalSeal(*blockchain.blocks.back());
+    journalCommit();
+}
+
+// Seal once the pending batch reaches the policy's size or age threshold; true if it did.
+static bool maybeSeal() {
+    const BlockStore& store = blockchain.blocks;
+    uint64_t pending = store.txCount() - store.sealedTxCount();
+    if (pending >= blockchain.policy.maxTxs ||
+        (pending && chrono::steady_clock::now() - blockchain.pendingSince >= blockchain.policy.maxAge)) {
+        sealBlock();
+        return true;
+    }
+    return false;
+}
+
+// ---------- Commit pipeline ----------
+// Producers (the engine ops) validate and change balances under their
+// account stripes, then push a CommitRecord into a bounded lock-free MPSC
+// ring while still holding the stripes, so ring order per account is the
+// order its balance changed. The ring ticket is the transaction number.
+// One sealer thread drains the ring in ticket order: it encodes and appends
+// the transaction, history and delta, builds the journal records and seals
+// blocks. It hands the records to a persistence thread that writes and
+// fdatasyncs the journal.
+struct CommitRecord {
+    TxKind kind{TxKind::Open};
+    Money amount{0};
+    Money delta{0};
+    User* users[2]{};    // accounts touched; users[1] is a transfer's destination
+    Money balances[2]{}; // their balances right after the change
+    bool opened{false};  // users[0] was created by this transaction
+    chrono::steady_clock::time_point enqueued{};
+};
+
+// Bounded multi-producer single-consumer ring with a sequence number per
+// slot. push() takes its ticket with one fetch_add and only waits when the
+// ring is full; pop() is for the single consumer.
+template <typename T, size_t CAPACITY_BITS>
+struct MpscRing {
+    static constexpr size_t CAPACITY = size_t(1) << CAPACITY_BITS;
+    static constexpr size_t MASK = CAPACITY - 1;
+    struct Slot {
+        atomic<uint64_t> seq;
+        T value;
+    };
+    unique_ptr<Slot[]> slots{new Slot[CAPACITY]};
+    alignas(64) atomic<uint64_t> tail{0}; // next ticket
+    alignas(64) atomic<uint64_t> head{0}; // next ticket to consume
+
+    MpscRing() {
+        for (size_t i = 0; i < CAPACITY; ++i) slots[i].seq.store(i, memory_order_relaxed);
+    }
+
+    uint64_t push(T&& v) {
+        uint64_t t = tail.fetch_add(1, memory_order_relaxed);
+        Slot& s = slots[t & MASK];
+        for (unsigned spins = 0; s.seq.load(memory_order_acquire) != t; ++spins)
+            if (spins >= 64) this_thread::yield();
+        s.value = std::move(v);
+        s.seq.store(t + 1, memory_order_release);
+        return t;
+    }
+    bool ready() const {
+        uint64_t h = head.load(memory_order_relaxed);
+        return slots[h & MASK].seq.load(memory_order_acquire) == h + 1;
+    }
+    bool pop(T& out) {
+        uint64_t h = head.load(memory_order_relaxed);
+        Slot& s = slots[h & MASK];
+        if (s.seq.load(memory_order_acquire) != h + 1) return false;
+        out = std::move(s.value);
+        s.seq.store(h + CAPACITY, memory_order_release);
+        head.store(h + 1, memory_order_release);
+        return true;
+    }
+    size_t depth() const { return tail.load(memory_order_relaxed) - head.load(memory_order_relaxed); }
+};
+
+// Count, total and maximum of one stage latency.
+struct LatencyStat {
+    atomic<uint64_t> count{0}, totalNs{0}, maxNs{0};
+
+    void record(chrono::steady_clock::duration d) {
+        uint64_t ns = static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(d).count());
+        count.fetch_add(1, memory_order_relaxed);
+        totalNs.fetch_add(ns, memory_order_relaxed);
+        for (uint64_t m = maxNs.load(memory_order_relaxed); ns > m && !maxNs.compare_exchange_weak(m, ns);) {}
+    }
+    double avgUs() const {
+        uint64_t n = count.load();
+        return n ? totalNs.load() / 1e3 / n : 0;
+    }
+    double maxUs() const { return maxNs.load() / 1e3; }
+};
+
+struct Pipeline {
+    MpscRing<CommitRecord, 14> ring;
+    uint64_t baseTx{0}; // transaction number of ticket 0
+    thread sealer, persister;
+    atomic<bool> running{false}; // read by drains while a checkpoint stops and restarts the stages
+    atomic<bool> stopSealer{false}, stopPersister{false}, sealRequested{false};
+
+    // Sealer wakeup; producers only take the lock when it is asleep.
+    mutex wakeLock;
+    condition_variable wake;
+    atomic<bool> sealerSleeping{false};
+
+    // Held by the sealer while it changes the chain, and by readers (drainPipeline).
+    mutex chainLock;
+    atomic<uint64_t> published{0}; // tickets applied and handed off
+
+    // Sealer -> persister handoff
+    mutex handoffLock;
+    condition_variable handoffReady;
+    string ready;
+    uint64_t readyOps{0};
+    atomic<uint64_t> persistedOps{0};
+
+    // Stage metrics
+    atomic<size_t> maxRingDepth{0};
+    LatencyStat queueWait, seal, write, sync;
+} pipeline;
+
+static void wakeSealer() {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (pipeline.sealerSleeping.load()) {
+        lock_guard<mutex> lock(pipeline.wakeLock);
+        pipeline.wake.notify_one();
+    }
+}
+
+// Producer side: returns the transaction number.
+static uint64_t submitCommit(CommitRecord&& rec) {
+    Pipeline& p = pipeline;
+    rec.enqueued = chrono::steady_clock::now();
+    uint64_t ticket = p.ring.push(std::move(rec));
+    size_t depth = p.ring.depth();
+    for (size_t m = p.maxRingDepth.load(memory_order_relaxed); depth > m && !p.maxRingDepth.compare_exchange_weak(m, depth);) {}
+    wakeSealer();
+    return p.baseTx + ticket;
+}
+
+static void applyCommitRecord(CommitRecord& rec) {
+    pipeline.queueWait.record(chrono::steady_clock::now() - rec.enqueued);
+    TxRecord t;
+    t.kind = rec.kind;
+    t.amount = rec.amount;
+    t.balance = rec.balances[0];
+    t.toBalance = rec.balances[1];
+    t.from = rec.users[0]->accountNumber;
+    if (rec.opened) t.to = rec.users[0]->name;
+    else if (rec.users[1]) t.to = rec.users[1]->accountNumber;
+    string data;
+    encodeTx(data, t);
+    uint64_t tx = addTransaction(std::move(data));
+    blockchain.txDelta.push_back(rec.delta);
+    journalTx(tx);
+    for (int k = 0; k < 2 && rec.users[k]; ++k) {
+        User* u = rec.users[k];
+        if (k == 0 || u != rec.users[0]) u->history.push_back(tx);
+        if (k == 0 && rec.opened) journalAccount(*u, rec.balances[k]);
+        else journalBalance(*u, rec.balances[k]);
+    }
+    journalCommit();
+    auto start = chrono::steady_clock::now();
+    if (maybeSeal()) pipeline.seal.record(chrono::steady_clock::now() - start);
+}
+
+static void handOff() {
+    Pipeline& p = pipeline;
+    {
+        lock_guard<mutex> lock(p.handoffLock);
+        if (p.readyOps == journal.committedOps) return;
+        if (p.ready.empty()) p.ready.swap(journal.pending);
+        else p.ready += journal.pending;
+        p.readyOps = journal.committedOps;
+    }
+    journal.pending.clear();
+    p.handoffReady.notify_one();
+}
+
+static void sealerLoop() {
+    Pipeline& p = pipeline;
+    CommitRecord rec;
+    for (;;) {
+        bool sealNow = p.sealRequested.load(memory_order_acquire);
+        // Sleep until a producer wakes us or the pending block comes of age.
+        auto timeout = chrono::milliseconds(100);
+        {
+            lock_guard<mutex> chain(p.chainLock);
+            for (size_t n = 1; p.ring.pop(rec); ++n) {
+                applyCommitRecord(rec);
+                if (n % 256 == 0) handOff(); // let the persister start on a long burst
+            }
+            auto start = chrono::steady_clock::now();
+            if (sealNow) sealBlock();
+            else if (maybeSeal()) p.seal.record(chrono::steady_clock::now() - start);
+            handOff();
+            p.published.store(p.ring.head.load(memory_order_relaxed), memory_order_release);
+            const BlockStore& store = blockchain.blocks;
+            if (store.txCount() > store.sealedTxCount())
+                timeout = min(timeout, chrono::duration_cast<chrono::milliseconds>(
+                                           blockchain.pendingSince + blockchain.policy.maxAge - chrono::steady_clock::now()));
+        }
+        if (sealNow) p.sealRequested.store(false, memory_order_release);
+        if (p.stopSealer.load() && !p.ring.ready()) break;
+
+        unique_lock<mutex> lock(p.wakeLock);
+        p.sealerSleeping.store(true);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (timeout.count() > 0 && !p.ring.ready() && !p.sealRequested.load() && !p.stopSealer.load())
+            p.wake.wait_for(lock, timeout);
+        p.sealerSleeping.store(false);
+    }
+}
+
+// journalSync, counted in the fdatasync stats.
+static void timedJournalSync() {
+    auto start = chrono::steady_clock::now();
+    if (journalSync()) pipeline.sync.record(chrono::steady_clock::now() - start);
+}
+
+static void persisterLoop() {
+    Pipeline& p = pipeline;
+    string writing;
+    for (;;) {
+        uint64_t ops;
+        {
+            unique_lock<mutex> lock(p.handoffLock);
+            p.handoffReady.wait_for(lock, Journal::SYNC_INTERVAL, [&] {
+                return p.readyOps != p.persistedOps.load(memory_order_relaxed) || p.stopPersister.load();
+            });
+            ops = p.readyOps;
+            writing.swap(p.ready);
+        }
+        uint64_t persisted = p.persistedOps.load(memory_order_relaxed);
+        if (ops == persisted) {
+            timedJournalSync(); // idle: flush the tail of the last batch
+            if (p.stopPersister.load()) break;
+            continue;
+        }
+        // After a failure the batch is dropped, but still counted so drains finish.
+        auto start = chrono::steady_clock::now();
+        journalWrite(writing);
+        p.write.record(chrono::steady_clock::now() - start);
+        writing.clear();
+        journal.unsyncedOps += ops - persisted;
+        p.persistedOps.store(ops, memory_order_release);
+        if (journal.unsyncedOps >= Journal::SYNC_BATCH ||
+            chrono::steady_clock::now() - journal.lastSync >= Journal::SYNC_INTERVAL)
+            timedJournalSync();
+    }
+}
+
+// Start the stages once the ledger and journal are loaded.
+static void startPipeline() {
+    Pipeline& p = pipeline;
+    if (p.running) return;
+    p.baseTx = blockchain.blocks.txCount() - p.ring.tail.load();
+    p.stopSealer = p.stopPersister = false;
+    p.sealer = thread(sealerLoop);
+    p.persister = thread(persisterLoop);
+    p.running = true;
+}
+
+// Wait until every operation submitted so far is applied and written, sealing
+// the pending block first if asked. Returns a lock that keeps the sealer off
+// the chain while the caller reads it.
+static unique_lock<mutex> drainPipeline(bool seal = false) {
+    Pipeline& p = pipeline;
+    if (!p.running) {
+        unique_lock<mutex> chain(p.chainLock);
+        if (seal) sealBlock();
+        return chain;
+    }
+    uint64_t target = p.ring.tail.load();
+    if (seal) p.sealRequested.store(true);
+    {
+        lock_guard<mutex> lock(p.wakeLock);
+        p.wake.notify_one();
+    }
+    while (p.published.load(memory_order_acquire) < target || p.sealRequested.load(memory_order_acquire))
+        this_thread::sleep_for(chrono::microseconds(50));
+    unique_lock<mutex> chain(p.chainLock);
+    uint64_t ops;
+    {
+        lock_guard<mutex> lock(p.handoffLock);
+        ops = p.readyOps;
+    }
+    while (p.persistedOps.load(memory_order_acquire) < ops) this_thread::sleep_for(chrono::microseconds(50));
+    return chain;
+}
+
+static void stopPipeline() {
+    Pipeline& p = pipeline;
+    if (!p.running) return;
+    drainPipeline();
+    p.stopSealer = true;
+    {
+        lock_guard<mutex> lock(p.wakeLock);
+        p.wake.notify_one();
+    }
+    p.sealer.join();
+    {
+        lock_guard<mutex> lock(p.handoffLock);
+        p.stopPersister = true;
+    }
+    p.handoffReady.notify_one();
+    p.persister.join();
+    p.running = false;
+}
+
+static void printPipelineStats(ostream& out) {
+    const Pipeline& p = pipeline;
+    out << fixed << setprecision(1)
+        << "Ingest:  ring depth " << p.ring.depth() << " (max " << p.maxRingDepth.load() << "), "
+        << p.queueWait.count.load() << " records, queue wait avg " << p.queueWait.avgUs() << " us, max "
+        << p.queueWait.maxUs() << " us\n"
+        << "Sealer:  " << p.seal.count.load() << " blocks sealed by policy, seal avg " << p.seal.avgUs()
+        << " us, max " << p.seal.maxUs() << " us\n"
+        << "Persist: " << journal.committedOps - p.persistedOps.load() << " ops pending, " << p.write.count.load()
+        << " writes avg " << p.write.avgUs() << " us (max " << p.write.maxUs() << "), " << p.sync.count.load()
+        << " fdatasyncs avg " << p.sync.avgUs() << " us (max " << p.sync.maxUs() << ")\n";
+}
+
+static void sealAndFlush() {
+    drainPipeline(true);
+}
+
+// ---------- Snapshots ----------
+// A snapshot is the account table at a block boundary: every account with
+// its balance and history, tagged with the block height, the head block's
+// hash and the ledger's running total. Startup loads it in place of users.csv
+// and indexes only the transactions after it. Every snapshot is taken at a
+// checkpoint that folds the journal into ledger.bin and users.csv and empties
+// it, so a cold start costs the accounts plus the journal since the last
+// checkpoint rather than the whole history. A background worker checkpoints
+// every `everyBlocks` sealed blocks (1024 by default) and at shutdown; export
+// checkpoints too.
+//
+// Layout: magic "BCSNAP01" | u32 version | i64 height | i64 txCount | 32-byte
+// head hash | i64 ledger total | i64 account count | per account: str number,
+// str name, str mobile, str password hash, i64 balance, i64 history length,
+// raw u64 history | u32 CRC-32 of everything before it
+static constexpr char SNAPSHOT_MAGIC[8] = {'B', 'C', 'S', 'N', 'A', 'P', '0', '1'};
+static constexpr uint32_t SNAPSHOT_VERSION = 1;
+
+struct SnapshotInfo {
+    uint64_t height{0};  // blocks covered
+    uint64_t txCount{0}; // transactions covered (all of them sealed)
+    Hash256 headHash{};
+    Money ledgerTotal{0};
+};
+
+struct SnapshotWorker {
+    uint64_t everyBlocks{1024};
+    thread worker;
+    mutex m;
+    condition_variable cv;
+    bool running{false};
+    bool stop{false};
+    BankDatabase* db{nullptr};
+    string path, usersPath, ledgerPath;
+    atomic<uint64_t> lastHeight{0};
+} snapshots;
+
+// Serialize the current state. The caller keeps engine ops out and the chain
+// sealed and quiet, so balances and histories match the chain's last block.
+static string serializeSnapshot(BankDatabase* db) {
+    const BlockStore& store = blockchain.blocks;
+    string out(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    putU32(out, SNAPSHOT_VERSION);
+    putI64(out, static_cast<int64_t>(store.size()));
+    putI64(out, static_cast<int64_t>(store.txCount()));
+    Hash256 head{};
+    if (!store.empty()) head = store.back()->hash;
+    out.append(reinterpret_cast<const char*>(head.data()), head.size());
+    putI64(out, accumulate(blockchain.txDelta.begin(), blockchain.txDelta.end(), blockchain.deltaBase));
+    putI64(out, static_cast<int64_t>(db->accounts.size()));
+    for (const User* u : db->accounts) {
+        putStr(out, u->accountNumber);
+        putStr(out, u->name);
+        putStr(out, u->mobile);
+        putStr(out, u->passwordHash);
+        putI64(out, u->balance);
+        putI64(out, static_cast<int64_t>(u->history.size()));
+        out.append(reinterpret_cast<const char*>(u->history.data()), u->history.size() * sizeof(uint64_t));
+    }
+    putU32(out, crc32(out.data(), out.size()));
+    return out;
+}
+
+// Write to a temp file and rename it into place, so a crash leaves the old snapshot.
+static bool writeSnapshotFile(const string& path, const string& data) {
+    STAT_SCOPE(Probe::WriteSnapshot);
+    const string tmp = path + ".tmp";
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        cerr << "Failed to open file: " << tmp << "\n";
+        return false;
+    }
+    BufferedWriter out(fd);
+    out.write(data);
+    out.flush();
+    bool ok = out.ok && fsync(fd) == 0;
+    close(fd);
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+        cerr << "Failed to write snapshot: " << path << "\n";
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Fold the journal into the bases (ledger.bin and users.csv), start a fresh
+// journal, remap the new ledger and snapshot it; with `txFile`, also write the
+// CSV export of the chain. Engine ops and the stages are held off because the
+// journal and chain are replaced, so this costs a rewrite of ledger.bin. Not
+// done once the journal has failed: the state holds changes the journal lost,
+// and emptying it would drop what is left to inspect.
+static bool checkpoint(BankDatabase* db, const string& usersFile, const string& ledgerFile,
+                       const string& snapshotFile, const string& txFile = "") {
+    if (journal.failed.load()) return false;
+    unique_lock<shared_mutex> accounts(engineLocks.accounts);
+    bool wasRunning = pipeline.running;
+    sealAndFlush();
+    stopPipeline();
+    bool written;
+    {
+        lock_guard<mutex> chain(pipeline.chainLock);
+        if ((written = writeLedger(ledgerFile))) {
+            saveUsersToCSV(db, usersFile);
+            if (journal.fd >= 0) {
+                timedJournalSync();
+                if (ftruncate(journal.fd, 0) != 0) cerr << "Failed to reset journal: " << strerror(errno) << "\n";
+                journal.size = 0;
+                journal.pending.clear(); // records made with the stages stopped are folded in already
+            }
+            openLedger(ledgerFile);
+            if (!blockchain.blocks.empty() && writeSnapshotFile(snapshotFile, serializeSnapshot(db)))
+                snapshots.lastHeight = blockchain.blocks.size();
+            if (!txFile.empty()) saveTransactionsToCSV(txFile);
+        }
+    }
+    if (wasRunning) startPipeline();
+    return written;
+}
+
+// Load the accounts of a snapshot into an empty database. The caller checks
+// `info` against the chain once the journal is replayed.
+static bool loadSnapshot(BankDatabase* db, const string& path, SnapshotInfo& info) {
+    STAT_SCOPE(Probe::LoadSnapshot);
+    string buf;
+    {
+        ifstream in(path, ios::binary | ios::ate);
+        if (!in) return false;
+        buf.resize(static_cast<size_t>(in.tellg()));
+        in.seekg(0);
+        if (!in.read(buf.data(), static_cast<streamsize>(buf.size()))) return false;
+    }
+    if (buf.size() < sizeof(SNAPSHOT_MAGIC) + 8 || memcmp(buf.data(), SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+        cerr << "Ignoring unrecognised snapshot " << path << "\n";
+        return false;
+    }
+    ByteReader crc{buf.data() + buf.size() - 4, buf.data() + buf.size()};
+    if (crc.u32() != crc32(buf.data(), buf.size() - 4)) {
+        cerr << "Ignoring corrupt snapshot " << path << "\n";
+        return false;
+    }
+    ByteReader r{buf.data() + sizeof(SNAPSHOT_MAGIC), buf.data() + buf.size() - 4};
+    if (r.u32() != SNAPSHOT_VERSION) {
+        cerr << "Ignoring snapshot " << path << " of another version\n";
+        return false;
+    }
+    info.height = static_cast<uint64_t>(r.i64());
+    info.txCount = static_cast<uint64_t>(r.i64());
+    r.bytes(info.headHash.data(), info.headHash.size());
+    info.ledgerTotal = r.i64();
+    uint64_t count = static_cast<uint64_t>(r.i64());
+    if (!r.ok || count > buf.size()) return false;
+    db->index.reserve(count);
+    for (uint64_t i = 0; i < count && r.ok; ++i) {
+        string acc = r.str(), name = r.str(), mobile = r.str(), passwordHash = r.str();
+        Money balance = r.i64();
+        uint64_t n = static_cast<uint64_t>(r.i64());
+        if (!r.ok || n > static_cast<uint64_t>(r.end - r.p) / sizeof(uint64_t)) {
+            r.ok = false;
+            break;
+        }
+        User* u = createUser(db, name, mobile, passwordHash, balance, acc);
+        if (!u) {
+            r.ok = false;
+            break;
+        }
+        u->history.resize(n);
+        r.bytes(u->history.data(), n * sizeof(uint64_t));
+    }
+    if (!r.ok || r.p != r.end) {
+        cerr << "Ignoring truncated snapshot " << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+// The snapshot still describes this chain if its head block is on it unchanged.
+static bool snapshotMatchesChain(const SnapshotInfo& info) {
+    const BlockStore& store = blockchain.blocks;
+    if (info.height == 0 || info.height > store.size()) return false;
+    const Block& head = store[info.height - 1];
+    return head.hash == info.headHash && head.firstTx + head.txCount == info.txCount;
+}
+
+static void snapshotLoop() {
+    SnapshotWorker& w = snapshots;
+    for (bool stop = false; !stop;) {
+        {
+            unique_lock<mutex> lock(w.m);
+            w.cv.wait_for(lock, chrono::seconds(1), [&] { return w.stop; });
+            stop = w.stop;
+        }
+        uint64_t height;
+        {
+            lock_guard<mutex> chain(pipeline.chainLock);
+            height = blockchain.blocks.size();
+        }
+        if (height >= w.lastHeight + w.everyBlocks || (stop && height > w.lastHeight))
+            checkpoint(w.db, w.usersPath, w.ledgerPath, w.path);
+    }
+}
+
+static void startSnapshots(BankDatabase* db, const string& path, const string& usersPath, const string& ledgerPath) {
+    SnapshotWorker& w = snapshots;
+    if (w.running) return;
+    w.db = db;
+    w.path = path;
+    w.usersPath = usersPath;
+    w.ledgerPath = ledgerPath;
+    w.stop = false;
+    w.worker = thread(snapshotLoop);
+    w.running = true;
+}
+
+// Stop the worker; it checkpoints a last time if blocks were sealed since the previous one.
+static void stopSnapshots() {
+    SnapshotWorker& w = snapshots;
+    if (!w.running) return;
+    {
+        lock_guard<mutex> lock(w.m);
+        w.stop = true;
+    }
+    w.cv.notify_one();
+    w.worker.join();
+    w.running = false;
+}
+
+static void closeJournal() {
+    stopSnapshots();
+    stopPipeline();
+    timedJournalSync();
+    if (journal.fd >= 0) close(journal.fd);
+    journal.fd = -1;
+}
+
+// A checkpoint that also writes the CSV export of the chain.
+static bool exportToCSV(BankDatabase* db, const string& usersFile, const string& ledgerFile, const string& txFile,
+                        const string& snapshotFile) {
+    if (journal.failed.load()) {
+        cerr << "The journal has failed; not exporting\n";
+        return false;
+    }
+    return checkpoint(db, usersFile, ledgerFile, snapshotFile, txFile);
+}
+
+// ---------- Chain verification ----------
+struct VerifyReport {
+    size_t blocks{0};
+    long long firstBad{-1}; // position of the first broken block, -1 if the chain is intact
+    string reason;
+    unsigned threads{1};
+    double seconds{0};
+};
+
+// Check blocks [lo, hi): stored index, transaction range, recomputed Merkle
+// root and hash, and the links to the previous block for every block except
+// `lo`, which is stitched by the caller. Headers are hashed eight at a time
+// through sha256Batch.
+static long long verifyRange(size_t lo, size_t hi, const atomic<long long>& stopBelow, string& reason) {
+    constexpr size_t LANES = 8;
+    uint8_t headers[LANES][BLOCK_HEADER_SIZE];
+    const uint8_t* ptrs[LANES];
+    Hash256 digests[LANES];
+    for (size_t i = 0; i < LANES; ++i) ptrs[i] = headers[i];
+
+    const BlockStore& store = blockchain.blocks;
+    for (size_t base = lo; base < hi; base += LANES) {
+        long long stop = stopBelow.load(memory_order_relaxed);
+        if (stop >= 0 && static_cast<long long>(base) > stop) return -1; // an earlier break already wins
+        size_t n = min(LANES, hi - base);
+        for (size_t k = 0; k < n; ++k) serializeBlockHeader(store[base + k], headers[k]);
+        sha256Batch(ptrs, BLOCK_HEADER_SIZE, digests, n);
+        for (size_t k = 0; k < n; ++k) {
+            size_t i = base + k;
+            const Block& b = store[i];
+            if (b.index != static_cast<int64_t>(i)) {
+                reason = "index " + to_string(b.index) + " at position " + to_string(i);
+                return static_cast<long long>(i);
+            }
+            if (!b.txCount || b.firstTx + b.txCount > store.sealedTxCount()) {
+                reason = "transaction range is empty or out of bounds";
+                return static_cast<long long>(i);
+            }
+            if (digests[k] != b.hash) {
+                reason = "stored hash does not match block header";
+                return static_cast<long long>(i);
+            }
+            if (i > lo && b.previousHash != store[i - 1].hash) {
+                reason = "previous hash does not match block " + to_string(i - 1);
+                return static_cast<long long>(i);
+            }
+            if (i > lo && b.firstTx != store[i - 1].firstTx + store[i - 1].txCount) {
+                reason = "transactions do not follow block " + to_string(i - 1);
+                return static_cast<long long>(i);
+            }
+            if (merkleRoot(store, b.firstTx, b.txCount) != b.merkleRoot) {
+                reason = "Merkle root does not match block transactions";
+                return static_cast<long long>(i);
+            }
+        }
+    }
+    return -1;
+}
+
+static VerifyReport verifyChain(unsigned threads = 0) {
+    constexpr size_t SEGMENT = 1 << 12; // blocks per work unit
+    VerifyReport report;
+    const size_t count = blockchain.blocks.size();
+    report.blocks = count;
+    if (!threads) threads = max(1u, thread::hardware_concurrency());
+    const size_t segments = (count + SEGMENT - 1) / SEGMENT;
+    threads = static_cast<unsigned>(max<size_t>(1, min<size_t>(threads, segments)));
+    report.threads = threads;
+
+    auto start = chrono::steady_clock::now();
+    atomic<size_t> nextSegment{0};
+    atomic<long long> firstBad{-1};
+    vector<long long> segBad(segments, -1);
+    vector<string> segReason(segments);
+
+    auto worker = [&]() {
+        for (size_t s; (s = nextSegment.fetch_add(1)) < segments;) {
+            size_t lo = s * SEGMENT, hi = min(count, lo + SEGMENT);
+            long long bad = verifyRange(lo, hi, firstBad, segReason[s]);
+            if (bad < 0) continue;
+            segBad[s] = bad;
+            long long cur = firstBad.load();
+            while ((cur < 0 || bad < cur) && !firstBad.compare_exchange_weak(cur, bad)) {}
+        }
+    };
+    vector<thread> pool;
+    for (unsigned t = 1; t < threads; ++t) pool.emplace_back(worker);
+    worker();
+    for (auto& th : pool) th.join();
+
+    // Stitch: the first block of each segment must link to the last block of the previous one.
+    const BlockStore& store = blockchain.blocks;
+    for (size_t s = 0; s < segments; ++s) {
+        size_t lo = s * SEGMENT;
+        const Block& b = store[lo];
+        const Block* prev = lo ? &store[lo - 1] : nullptr;
+        if (b.previousHash != (prev ? prev->hash : Hash256{})) {
+            report.firstBad = static_cast<long long>(lo);
+            report.reason = prev ? "previous hash does not match block " + to_string(lo - 1)
+                                 : "genesis block has a non-zero previous hash";
+            break;
+        }
+        if (b.firstTx != (prev ? prev->firstTx + prev->txCount : 0)) {
+            report.firstBad = static_cast<long long>(lo);
+            report.reason = prev ? "transactions do not follow block " + to_string(lo - 1)
+                                 : "genesis block does not start at transaction 0";
+            break;
+        }
+        if (segBad[s] >= 0) {
+            report.firstBad = segBad[s];
+            report.reason = segReason[s];
+            break;
+        }
+    }
+
+    report.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return report;
+}
+
+static bool printVerifyReport(const VerifyReport& r) {
+    double rate = r.seconds > 0 ? r.blocks / r.seconds : 0;
+    cout << "Verified " << r.blocks << " blocks in " << fixed << setprecision(3) << r.seconds << " s ("
+         << setprecision(0) << rate << " blocks/sec, " << r.threads << " threads, "
+         << sha256Impl().name << ")\n";
+    const BlockStore& store = blockchain.blocks;
+    if (store.txCount() > store.sealedTxCount())
+        cout << store.txCount() - store.sealedTxCount() << " pending transactions are not yet sealed.\n";
+    if (r.firstBad < 0) {
+        cout << "Blockchain intact.\n";
+        return true;
+    }
+    cout << "Broken link at block " << r.firstBad;
+    if (static_cast<size_t>(r.firstBad) < store.size())
+        cout << " (" << transactionID(store[static_cast<size_t>(r.firstBad)].firstTx) << " onwards)";
+    cout << ": " << r.reason << "\n";
+    return false;
+}
+
+// Verify the loaded chain; a defect found while loading a CSV counts if it
+// comes before the first broken link.
+static bool verifyLoaded(const CsvDefect& defect) {
+    VerifyReport report = verifyChain();
+    if (defect.block >= 0 && (report.firstBad < 0 || defect.block <= report.firstBad)) {
+        report.firstBad = defect.block;
+        report.reason = defect.reason;
+    }
+    return printVerifyReport(report);
+}
+
+// ---------- Transaction lookup ----------
+// Transaction IDs are dense numbers, so the store's offset index and arena
+// already map ID -> data in O(1), and the header array, sorted by firstTx,
+// maps ID -> block in O(log blocks). Both grow with every append.
+
+// Accepts "TRX-<n>" or a bare transaction number.
+static bool parseTransactionID(const string& id, uint64_t& n) {
+    string_view digits = id;
+    if (digits.substr(0, 4) == "TRX-") digits.remove_prefix(4);
+    auto [end, ec] = from_chars(digits.data(), digits.data() + digits.size(), n);
+    return !digits.empty() && ec == errc() && end == digits.data() + digits.size();
+}
+
+// Position of the block sealing transaction n, or size() if n is pending or unknown.
+static size_t findBlockForTx(const BlockStore& store, uint64_t n) {
+    if (n >= store.sealedTxCount()) return store.size();
+    size_t lo = 0, hi = store.size();
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (store[mid].firstTx <= n) lo = mid;
+        else hi = mid;
+    }
+    return lo;
+}
+
+struct TxLookup {
+    uint64_t tx{0};
+    string_view data;
+    const Block* block{nullptr}; // nullptr while the transaction is pending
+};
+
+static bool lookupTransaction(const string& id, TxLookup& out) {
+    const BlockStore& store = blockchain.blocks;
+    if (!parseTransactionID(id, out.tx) || out.tx >= store.txCount()) return false;
+    out.data = store.tx(out.tx);
+    size_t i = findBlockForTx(store, out.tx);
+    out.block = i < store.size() ? &store[i] : nullptr;
+    return true;
+}
+
+static void printTransaction(const string& id) {
+    TxLookup t;
+    if (!lookupTransaction(id, t)) {
+        cout << "Transaction " << id << " not found.\n";
+        return;
+    }
+    cout << transactionID(t.tx) << ": " << txText(t.data) << "\n";
+    if (!t.block) {
+        cout << "  Pending, not yet sealed into a block.\n";
+        return;
+    }
+    time_t ts = static_cast<time_t>(t.block->timestamp);
+    char when[32];
+    strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", localtime(&ts));
+    cout << "  Block " << t.block->index << " (" << t.tx - t.block->firstTx + 1 << " of " << t.block->txCount
+         << "), sealed " << when << ", hash " << toHex(t.block->hash) << "\n";
+}
+
+// ---------- Merkle proofs ----------
+// A proof ties one transaction to a block header: the transaction data, the
+// full header and the sibling hashes on the leaf's path. Checking it takes
+// O(log txCount) hashes and needs nothing from the ledger; the auditor then
+// compares the block hash against one they trust. Text layout, one field per line:
+//
+//   tx <n>
+//   payload <hex>        (a transaction record, followed by a "# <text>" comment)
+//   data <text>          (in place of payload for a text transaction)
+//   block <index> <timestamp> <firstTx> <txCount>
+//   previous <hex>
+//   merkle <hex>
+//   hash <hex>
+//   sibling <hex>        (zero or more, leaf level first)
+struct MerkleProof {
+    uint64_t tx{0};
+    string data;
+    Block block;
+    vector<Hash256> siblings;
+};
+
+static bool buildMerkleProof(uint64_t tx, MerkleProof& proof) {
+    const BlockStore& store = blockchain.blocks;
+    size_t i = findBlockForTx(store, tx);
+    if (i == store.size()) return false;
+    proof.tx = tx;
+    proof.data = string(store.tx(tx));
+    proof.block = store[i];
+    proof.siblings = merklePath(store, proof.block.firstTx, proof.block.txCount, tx - proof.block.firstTx);
+    return true;
+}
+
+static bool checkMerkleProof(const MerkleProof& proof, string& reason) {
+    const Block& b = proof.block;
+    if (proof.tx < b.firstTx || proof.tx - b.firstTx >= b.txCount) {
+        reason = "transaction is outside the block's range";
+        return false;
+    }
+    if (computeHash(b) != b.hash) {
+        reason = "block hash does not match the header";
+        return false;
+    }
+    Hash256 root;
+    if (!merkleRootFromPath(merkleLeaf(proof.data), proof.tx - b.firstTx, b.txCount, proof.siblings, root)) {
+        reason = "sibling count does not fit the block size";
+        return false;
+    }
+    if (root != b.merkleRoot) {
+        reason = "transaction does not hash to the block's Merkle root";
+        return false;
+    }
+    return true;
+}
+
+static void writeMerkleProof(ostream& out, const MerkleProof& proof) {
+    const Block& b = proof.block;
+    TxRecord t;
+    out << "tx " << proof.tx << "\n";
+    if (decodeTx(proof.data, t))
+        out << "payload " << toHex(reinterpret_cast<const uint8_t*>(proof.data.data()), proof.data.size()) << "\n"
+            << "# " << txText(proof.data) << "\n";
+    else
+        out << "data " << proof.data << "\n";
+    out << "block " << b.index << ' ' << b.timestamp << ' ' << b.firstTx << ' ' << b.txCount << "\n"
+        << "previous " << toHex(b.previousHash) << "\n"
+        << "merkle " << toHex(b.merkleRoot) << "\n"
+        << "hash " << toHex(b.hash) << "\n";
+    for (const Hash256& h : proof.siblings) out << "sibling " << toHex(h) << "\n";
+}
+
+static bool readMerkleProof(istream& in, MerkleProof& proof) {
+    Block& b = proof.block;
+    unsigned seen = 0;
+    string line;
+    while (getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        size_t sp = line.find(' ');
+        string key = line.substr(0, sp), value = sp == string::npos ? "" : line.substr(sp + 1);
+        bool ok = true;
+        if (key == "tx") ok = parseTransactionID(value, proof.tx), seen |= 1;
+        else if (key == "data") proof.data = value, seen |= 2;
+        else if (key == "payload") {
+            proof.data.assign(value.size() / 2, '\0');
+            ok = parseHex(value, reinterpret_cast<uint8_t*>(proof.data.data()), proof.data.size()), seen |= 2;
+        }
+        else if (key == "block") ok = bool(istringstream(value) >> b.index >> b.timestamp >> b.firstTx >> b.txCount), seen |= 4;
+        else if (key == "previous") ok = parseHex(value, b.previousHash), seen |= 8;
+        else if (key == "merkle") ok = parseHex(value, b.merkleRoot), seen |= 16;
+        else if (key == "hash") ok = parseHex(value, b.hash), seen |= 32;
+        else if (key == "sibling") ok = parseHex(value, proof.siblings.emplace_back());
+        else ok = key.empty() || key[0] == '#';
+        if (!ok) return false;
+    }
+    return seen == 63;
+}
+
+// ---------- Account history ----------
+// Each User keeps the numbers of the transactions that touch it. The engine
+// appends as it records transactions; on load the lists come from the
+// snapshot and are extended by reading the account numbers out of the
+// transactions after it (all of them without a snapshot).
+static constexpr size_t STATEMENT_PAGE_SIZE = 20;
+
+static string_view accountAt(string_view data, size_t p) {
+    size_t e = p;
+    while (e < data.size() && isalnum(static_cast<unsigned char>(data[e]))) ++e;
+    return data.substr(p, e - p);
+}
+
+static string_view accountAfter(string_view data, string_view marker, bool last = false) {
+    size_t p = last ? data.rfind(marker) : data.find(marker);
+    return p == string_view::npos ? string_view() : accountAt(data, p + marker.size());
+}
+
+// Accounts named by a transaction produced by the engine; returns how many (0-2).
+static size_t accountsInTransaction(string_view data, string_view out[2]) {
+    TxRecord t;
+    if (decodeTx(data, t)) {
+        out[0] = t.from;
+        if (t.kind != TxKind::Transfer || t.to == t.from) return 1;
+        out[1] = t.to;
+        return 2;
+    }
+    auto starts = [&](string_view prefix) { return data.substr(0, prefix.size()) == prefix; };
+    size_t n = 0;
+    if (starts("Created account")) {
+        out[n++] = accountAfter(data, ". Account Number: ", true);
+    } else if (starts("Deposited")) {
+        out[n++] = accountAfter(data, " to ");
+    } else if (starts("Withdrawn")) {
+        out[n++] = accountAfter(data, " from ");
+    } else if (starts("Transferred")) {
+        size_t from = data.find(" from ");
+        if (from == string_view::npos) return 0;
+        out[n++] = accountAt(data, from + 6);
+        out[n++] = accountAfter(data.substr(from), " to ");
+        if (out[1] == out[0]) --n;
+    }
+    return n;
+}
+
+// Index transactions [firstTx, end) into the account histories.
+static void buildAccountHistory(BankDatabase* db, uint64_t firstTx = 0) {
+    for (User& u : db->storage)
+        while (!u.history.empty() && u.history.back() >= firstTx) u.history.pop_back();
+    const BlockStore& store = blockchain.blocks;
+    const uint64_t total = store.txCount();
+    // Parse in parallel into per-range lists, then append them in order so histories stay sorted.
+    constexpr uint64_t RANGE = 1 << 16;
+    vector<vector<pair<User*, uint64_t>>> hits((max(total, firstTx) - firstTx + RANGE - 1) / RANGE);
+    parallelFor(hits.size(), 1, [&](size_t lo, size_t hi) {
+        string_view accounts[2];
+        for (size_t r = lo; r < hi; ++r)
+            for (uint64_t n = firstTx + r * RANGE; n < min(total, firstTx + (r + 1) * RANGE); ++n)
+                for (size_t k = 0, m = accountsInTransaction(store.tx(n), accounts); k < m; ++k)
+                    if (User* u = db->index.find(accounts[k])) hits[r].emplace_back(u, n);
+    });
+    for (const auto& range : hits)
+        for (const auto& [u, n] : range) u->history.push_back(n);
+}
+
+// One page (0-based, newest first) of an account's transactions.
+static void printStatement(const User& u, size_t page = 0, size_t pageSize = STATEMENT_PAGE_SIZE) {
+    const BlockStore& store = blockchain.blocks;
+    size_t total = u.history.size();
+    size_t pages = max<size_t>(1, (total + pageSize - 1) / pageSize);
+    string out = "Statement for Account #" + u.accountNumber + " (" + to_string(total) + " transactions, page " +
+                 to_string(page + 1) + " of " + to_string(pages) + "):\n";
+    char when[32];
+    for (size_t k = page * pageSize; k < min(total, (page + 1) * pageSize); ++k) {
+        uint64_t n = u.history[total - 1 - k];
+        size_t b = findBlockForTx(store, n);
+        if (b < store.size()) {
+            time_t ts = static_cast<time_t>(store[b].timestamp);
+            strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", localtime(&ts));
+        } else {
+            snprintf(when, sizeof(when), "pending");
+        }
+        out += transactionID(n) + "  " + when + "  ";
+        appendTxText(out, store.tx(n));
+        out += '\n';
+    }
+    cout << out;
+}
+
+// ---------- Time range queries ----------
+// Block timestamps mostly increase, but not across restarts with a clock
+// change or ledgers imported out of order, so neither a binary search over
+// the blocks nor a scan that stops early is safe on its own. The time index
+// keeps the min/max timestamp of every TIME_SEGMENT blocks and groups
+// consecutive in-order segments into runs: a query binary-searches each run's
+// directory for its start and reads headers only until it passes the end,
+// and checks other segments against their min/max before reading any header.
+static constexpr size_t TIME_SEGMENT = 64;
+
+// Add segments for blocks sealed since the last call.
+static void extendTimeIndex() {
+    const BlockStore& store = blockchain.blocks;
+    TimeIndex& ix = blockchain.timeIndex;
+    if (ix.segments.size() * TIME_SEGMENT > store.size()) ix = TimeIndex(); // store replaced underneath
+    for (size_t s = ix.segments.size(); (s + 1) * TIME_SEGMENT <= store.size(); ++s) {
+        TimeSegment seg{store[s * TIME_SEGMENT].timestamp, store[s * TIME_SEGMENT].timestamp, true};
+        for (size_t i = s * TIME_SEGMENT + 1; i < (s + 1) * TIME_SEGMENT; ++i) {
+            int64_t ts = store[i].timestamp;
+            seg.ordered = seg.ordered && ts >= store[i - 1].timestamp;
+            seg.minTs = min(seg.minTs, ts);
+            seg.maxTs = max(seg.maxTs, ts);
+        }
+        const TimeSegment* prev = s ? &ix.segments[s - 1] : nullptr;
+        if (!prev || !prev->ordered || !seg.ordered || seg.minTs < prev->maxTs) ix.runs.push_back(s);
+        ix.segments.push_back(seg);
+    }
+}
+
+// Positions of the sealed blocks with from <= timestamp <= to, in chain order.
+static vector<size_t> findBlocksInTime(int64_t from, int64_t to) {
+    STAT_SCOPE(Probe::TimeRange);
+    extendTimeIndex();
+    const BlockStore& store = blockchain.blocks;
+    const TimeIndex& ix = blockchain.timeIndex;
+    vector<size_t> out;
+    auto scan = [&](size_t lo, size_t hi) {
+        for (size_t i = lo; i < hi; ++i)
+            if (store[i].timestamp >= from && store[i].timestamp <= to) out.push_back(i);
+    };
+    for (size_t r = 0; r < ix.runs.size(); ++r) {
+        size_t first = ix.runs[r], last = r + 1 < ix.runs.size() ? ix.runs[r + 1] : ix.segments.size();
+        if (!ix.segments[first].ordered) { // an out-of-order segment is a run of its own
+            if (ix.segments[first].minTs <= to && ix.segments[first].maxTs >= from)
+                scan(first * TIME_SEGMENT, (first + 1) * TIME_SEGMENT);
+            continue;
+        }
+        auto begin = ix.segments.begin() + first, end = ix.segments.begin() + last;
+        size_t s = partition_point(begin, end, [&](const TimeSegment& g) { return g.maxTs < from; }) - ix.segments.begin();
+        if (s == last || ix.segments[s].minTs > to) continue;
+        size_t lo = s * TIME_SEGMENT, hi = (s + 1) * TIME_SEGMENT;
+        while (lo < hi) { // first block of segment s at or after from
+            size_t mid = lo + (hi - lo) / 2;
+            if (store[mid].timestamp < from) lo = mid + 1;
+            else hi = mid;
+        }
+        for (size_t i = lo; i < last * TIME_SEGMENT && store[i].timestamp <= to; ++i) out.push_back(i);
+    }
+    scan(ix.segments.size() * TIME_SEGMENT, store.size());
+    return out;
+}
+
+// Unix seconds, or YYYY-MM-DD[ HH:MM:SS] (also with a 'T') in local time.
+static bool parseTimestamp(const string& s, int64_t& out) {
+    if (parseInt(s, out)) return true;
+    tm t{};
+    char sep;
+    int n = sscanf(s.c_str(), "%d-%d-%d%c%d:%d:%d", &t.tm_year, &t.tm_mon, &t.tm_mday, &sep, &t.tm_hour, &t.tm_min,
+                   &t.tm_sec);
+    if (n != 3 && n != 7) return false;
+    t.tm_year -= 1900;
+    t.tm_mon -= 1;
+    t.tm_isdst = -1;
+    out = static_cast<int64_t>(mktime(&t));
+    return true;
+}
+
+// One page (0-based, oldest first) of the transactions sealed between from and
+// to; returns the number of pages.
+static size_t printTimeRange(int64_t from, int64_t to, size_t page = 0, size_t pageSize = STATEMENT_PAGE_SIZE) {
+    const BlockStore& store = blockchain.blocks;
+    vector<size_t> blocks = findBlocksInTime(from, to);
+    uint64_t total = 0;
+    for (size_t b : blocks) total += store[b].txCount;
+    size_t pages = max<size_t>(1, (total + pageSize - 1) / pageSize);
+    string out = to_string(total) + " transactions in " + to_string(blocks.size()) + " blocks (page " +
+                 to_string(page + 1) + " of " + to_string(pages) + "):\n";
+    char when[32];
+    uint64_t skip = page * pageSize, left = pageSize;
+    for (size_t k = 0; k < blocks.size() && left; ++k) {
+        const Block& b = store[blocks[k]];
+        if (skip >= b.txCount) {
+            skip -= b.txCount;
+            continue;
+        }
+        time_t ts = static_cast<time_t>(b.timestamp);
+        strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", localtime(&ts));
+        for (uint64_t n = b.firstTx + skip; n < b.firstTx + b.txCount && left; ++n, --left) {
+            out += transactionID(n) + "  " + when + "  block " + to_string(b.index) + "  ";
+            appendTxText(out, store.tx(n));
+            out += '\n';
+        }
+        skip = 0;
+    }
+    cout << out;
+    return pages;
+}
+
+// ---------- Reconciliation ----------
+// The books balance when the sum of all account balances equals the money
+// the ledger brought in: opening and later deposits minus withdrawals
+// (transfers net to zero). Per-transaction deltas live in a flat column and
+// balances are gathered through db->accounts; both are summed with AVX2 where
+// available. Sums wrap mod 2^64 the same way on both sides, so comparing them
+// stays exact.
+struct ReconcileReport {
+    size_t accounts{0}, transactions{0};
+    Money balances{0}, ledger{0};
+    double seconds{0};
+};
+
+// Money a transaction produced by the engine adds to the bank's total.
+static Money transactionDelta(string_view data) {
+    TxRecord t;
+    if (decodeTx(data, t))
+        return t.kind == TxKind::Withdraw ? -t.amount : t.kind == TxKind::Transfer ? 0 : t.amount;
+    auto starts = [&](string_view prefix) { return data.substr(0, prefix.size()) == prefix; };
+    Money m = 0;
+    if (starts("Created account")) {
+        size_t p = data.rfind(" initial deposit of Rs.");
+        if (p != string_view::npos) scanMoney(data.substr(p + 23), m);
+    } else if (starts("Deposited Rs.")) {
+        scanMoney(data.substr(13), m);
+    } else if (starts("Withdrawn Rs.")) {
+        scanMoney(data.substr(13), m);
+        m = -m;
+    }
+    return m;
+}
+
+// Fill the delta column from transaction `firstTx` on; `base` is the total of the ones before it.
+static void buildLedgerDeltas(uint64_t firstTx = 0, Money base = 0) {
+    const BlockStore& store = blockchain.blocks;
+    vector<Money>& delta = blockchain.txDelta;
+    blockchain.deltaFirstTx = firstTx = min(firstTx, store.txCount());
+    blockchain.deltaBase = base;
+    delta.resize(store.txCount() - firstTx);
+    parallelFor(delta.size(), 1 << 16, [&](size_t lo, size_t hi) {
+        for (size_t n = lo; n < hi; ++n) delta[n] = transactionDelta(store.tx(firstTx + n));
+    });
+}
+
+static uint64_t sumMoneyScalar(const Money* p, size_t n) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < n; ++i) sum += static_cast<uint64_t>(p[i]);
+    return sum;
+}
+
+static uint64_t sumBalancesScalar(User* const* users, size_t n) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < n; ++i) sum += static_cast<uint64_t>(users[i]->balance);
+    return sum;
+}
+
+#ifdef SHA256_HAVE_X86
+__attribute__((target("avx2")))
+static uint64_t horizontalSum(__m256i v) {
+    alignas(32) uint64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), v);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+__attribute__((target("avx2")))
+static uint64_t sumMoneyAvx2(const Money* p, size_t n) {
+    __m256i a0 = _mm256_setzero_si256(), a1 = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        a0 = _mm256_add_epi64(a0, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i)));
+        a1 = _mm256_add_epi64(a1, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i + 4)));
+    }
+    return horizontalSum(_mm256_add_epi64(a0, a1)) + sumMoneyScalar(p + i, n - i);
+}
+#endif
+
+static bool cpuHasAvx2() {
+#ifdef SHA256_HAVE_X86
+    static const bool has = (__builtin_cpu_init(), __builtin_cpu_supports("avx2"));
+    return has;
+#else
+    return false;
+#endif
+}
+
+// The balances live in the accounts, so they are copied into a flat block
+// at a time and summed with the same kernel as the deltas.
+static uint64_t sumBalances(User* const* users, size_t n) {
+#ifdef SHA256_HAVE_X86
+    if (cpuHasAvx2()) {
+        constexpr size_t BLOCK = 1024;
+        Money flat[BLOCK];
+        uint64_t sum = 0;
+        for (size_t i = 0; i < n; i += BLOCK) {
+            size_t m = min(BLOCK, n - i);
+            for (size_t k = 0; k < m; ++k) flat[k] = users[i + k]->balance;
+            sum += sumMoneyAvx2(flat, m);
+        }
+        return sum;
+    }
+#endif
+    return sumBalancesScalar(users, n);
+}
+
+static ReconcileReport reconcile(BankDatabase* db) {
+    constexpr size_t GRAIN = 1 << 18;
+    auto start = chrono::steady_clock::now();
+    ReconcileReport r;
+    const vector<Money>& delta = blockchain.txDelta;
+    const vector<User*>& users = db->accounts;
+    r.accounts = users.size();
+    r.transactions = blockchain.deltaFirstTx + delta.size();
+    atomic<uint64_t> balances{0}, ledger{static_cast<uint64_t>(blockchain.deltaBase)};
+    parallelFor(delta.size(), GRAIN, [&](size_t lo, size_t hi) {
+#ifdef SHA256_HAVE_X86
+        if (cpuHasAvx2()) {
+            ledger += sumMoneyAvx2(delta.data() + lo, hi - lo);
+            return;
+        }
+#endif
+        ledger += sumMoneyScalar(delta.data() + lo, hi - lo);
+    });
+    parallelFor(users.size(), GRAIN, [&](size_t lo, size_t hi) {
+        balances += sumBalances(users.data() + lo, hi - lo);
+    });
+    r.balances = static_cast<Money>(balances.load());
+    r.ledger = static_cast<Money>(ledger.load());
+    r.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return r;
+}
+
+static bool printReconcileReport(const ReconcileReport& r, ostream& out = cout) {
+    out << "Reconciled " << r.accounts << " accounts against " << r.transactions << " transactions in "
+        << fixed << setprecision(3) << r.seconds * 1000 << " ms (" << (cpuHasAvx2() ? "avx2" : "scalar") << ")\n";
+    if (r.balances == r.ledger) {
+        out << "Balances match the ledger: Rs." << moneyString(r.balances) << "\n";
+        return true;
+    }
+    out << "MISMATCH: balances total Rs." << moneyString(r.balances) << ", ledger total Rs." << moneyString(r.ledger)
+        << " (difference Rs." << moneyString(r.balances - r.ledger) << ")\n";
+    return false;
+}
+
+// ---------- Banking ops ----------
+static constexpr size_t ACCOUNTS_PAGE_SIZE = 20;
+
+// Print one page (0-based) of accounts in account-number order.
+static void printUsers(BankDatabase* db, size_t page = 0, size_t pageSize = ACCOUNTS_PAGE_SIZE) {
+    size_t pages = max<size_t>(1, (db->accounts.size() + pageSize - 1) / pageSize);
+    string out = "List of Users (page " + to_string(page + 1) + " of " + to_string(pages) + "):\n";
+    forEachAccount(db, [&](const User& u) {
+        out += "Account #" + u.accountNumber + ": " + u.name + ", Mobile: " + u.mobile + ", Balance: Rs.";
+        appendMoney(out, u.balance);
+        out += '\n';
+    }, page * pageSize, pageSize);
+    cout << out;
+}
+
+// ---------- Sessions ----------
+// A password check runs the KDF, so it is paid once per account: a verified
+// password leaves a tag on the account (HMAC under a per-process random key
+// that is never stored), and later operations with the same password cost one
+// HMAC and a compare until the tag expires. Clients can also trade a password
+// for a session token (login) and send the token wherever a password goes.
+static constexpr auto SESSION_TTL = chrono::minutes(30);
+static constexpr size_t SESSION_TOKEN_BYTES = 16;
+static constexpr char SESSION_TOKEN_PREFIX[] = "sess-";
+
+struct Session {
+    const User* user;
+    chrono::steady_clock::time_point expires;
+};
+
+static HmacSha256 randomTagKey() {
+    uint8_t key[32];
+    randomBytes(key, sizeof(key));
+    return HmacSha256(key, sizeof(key));
+}
+
+struct SessionTable {
+    static constexpr unsigned SHARDS = 64;
+    struct alignas(64) Shard {
+        mutex m;
+        unordered_map<string, Session> live;
+        size_t sweepAt{64}; // drop expired sessions once the shard grows past this
+    };
+    Shard shards[SHARDS];
+    HmacSha256 tagKey = randomTagKey();
+
+    Shard& shardFor(const string& token) { return shards[hash<string>{}(token) % SHARDS]; }
+} sessions;
+
+static bool isSessionToken(const string& s) {
+    return s.size() == sizeof(SESSION_TOKEN_PREFIX) - 1 + 2 * SESSION_TOKEN_BYTES &&
+           s.compare(0, sizeof(SESSION_TOKEN_PREFIX) - 1, SESSION_TOKEN_PREFIX) == 0;
+}
+
+static string openSession(const User* user) {
+    uint8_t raw[SESSION_TOKEN_BYTES];
+    randomBytes(raw, sizeof(raw));
+    string token = SESSION_TOKEN_PREFIX + toHex(raw, sizeof(raw));
+    auto now = chrono::steady_clock::now();
+    SessionTable::Shard& s = sessions.shardFor(token);
+    lock_guard<mutex> lock(s.m);
+    if (s.live.size() >= s.sweepAt) {
+        for (auto it = s.live.begin(); it != s.live.end();)
+            it = it->second.expires <= now ? s.live.erase(it) : next(it);
+        s.sweepAt = max<size_t>(64, 2 * s.live.size());
+    }
+    s.live[token] = Session{user, now + SESSION_TTL};
+    return token;
+}
+
+// True if `token` is a live session of `user`; each use extends it.
+static bool checkSession(const string& token, const User* user) {
+    auto now = chrono::steady_clock::now();
+    SessionTable::Shard& s = sessions.shardFor(token);
+    lock_guard<mutex> lock(s.m);
+    auto it = s.live.find(token);
+    if (it == s.live.end() || it->second.user != user) return false;
+    if (it->second.expires <= now) {
+        s.live.erase(it);
+        return false;
+    }
+    it->second.expires = now + SESSION_TTL;
+    return true;
+}
+
+static bool closeSession(const string& token, const User* user) {
+    SessionTable::Shard& s = sessions.shardFor(token);
+    lock_guard<mutex> lock(s.m);
+    auto it = s.live.find(token);
+    if (it == s.live.end() || it->second.user != user) return false;
+    s.live.erase(it);
+    return true;
+}
+
+static Hash256 credentialTag(const User& u, const string& password) {
+    HmacSha256 h = sessions.tagKey;
+    h.update(u.accountNumber.data(), u.accountNumber.size() + 1); // keep the NUL as a separator
+    h.update(password.data(), password.size());
+    return h.finish();
+}
+
+// Remember a verified password on the account (call under its stripe).
+static void cacheCredential(User& u, const Hash256& tag) {
+    u.authTag = tag;
+    u.authExpires = chrono::steady_clock::now() + SESSION_TTL;
+}
+
+// `credential` is the account's password or a session token. The KDF only
+// runs when the password is not already cached, and never under the stripe.
+static bool authenticateUser(User* user, const string& credential) {
+    STAT_SCOPE(Probe::Authenticate);
+    if (!user || credential.empty()) {
+        STAT_COUNT(Counter::AuthFailed);
+        return false;
+    }
+    if (isSessionToken(credential) && checkSession(credential, user)) {
+        STAT_COUNT(Counter::AuthSession);
+        return true;
+    }
+    const Hash256 tag = credentialTag(*user, credential);
+    {
+        lock_guard<mutex> stripe(stripeFor(user));
+        if (chrono::steady_clock::now() < user->authExpires &&
+            constantTimeEqual(tag.data(), user->authTag.data(), tag.size())) {
+            STAT_COUNT(Counter::AuthCached);
+            return true;
+        }
+    }
+    if (!verifyPassword(user->passwordHash, credential)) {
+        STAT_COUNT(Counter::AuthFailed);
+        return false;
+    }
+    lock_guard<mutex> stripe(stripeFor(user));
+    cacheCredential(*user, tag);
+    return true;
+}
+
+// Whether authenticateUser can answer without the KDF: no such account, a
+// live session token or a cached password.
+static bool credentialCheap(User* user, const string& credential) {
+    if (!user || credential.empty() || (isSessionToken(credential) && checkSession(credential, user))) return true;
+    const Hash256 tag = credentialTag(*user, credential);
+    lock_guard<mutex> stripe(stripeFor(user));
+    return chrono::steady_clock::now() < user->authExpires &&
+           constantTimeEqual(tag.data(), user->authTag.data(), tag.size());
+}
+
+// Hash any plaintext passwords left by older users.csv files or journals.
+// Returns true if there were any, so the caller can rewrite the files.
+static bool upgradePlaintextPasswords(BankDatabase* db) {
+    vector<User*> legacy;
+    for (User* u : db->accounts)
+        if (!isPasswordHash(u->passwordHash)) legacy.push_back(u);
+    if (legacy.empty()) return false;
+    cerr << "Hashing " << legacy.size() << " plaintext passwords\n";
+    parallelFor(legacy.size(), 1, [&](size_t lo, size_t hi) {
+        for (size_t i = lo; i < hi; ++i) legacy[i]->passwordHash = hashPassword(legacy[i]->passwordHash);
+    });
+    return true;
+}
+
+// ---------- Engine ----------
+// Non-interactive operations shared by the menu, batch mode and worker
+// threads. Each one validates and applies the balance change under its
+// account stripe(s) and submits the transaction to the commit pipeline
+// before releasing them; it returns without waiting for the sealer. Once the
+// journal has failed, every change is refused with JournalFailed.
+enum class OpStatus { Ok, AuthFailed, NotFound, InsufficientFunds, Invalid, JournalFailed };
+
+static const char* opStatusName(OpStatus s) {
+    switch (s) {
+        case OpStatus::Ok: return "ok";
+        case OpStatus::AuthFailed: return "auth_failed";
+        case OpStatus::NotFound: return "not_found";
+        case OpStatus::InsufficientFunds: return "insufficient_funds";
+        case OpStatus::JournalFailed: return "journal_failed";
+        default: return "invalid";
+    }
+}
+
+struct OpResult {
+    OpStatus status{OpStatus::Ok};
+    User* user{nullptr};    // account created, credited or debited
+    User* target{nullptr};  // transfer destination
+    uint64_t tx{0};         // transaction number
+    Money balance{0};       // user's balance right after the operation
+    string token;           // session opened by login
+};
+
+static OpResult openAccount(BankDatabase* db, const string& name, const string& mobile,
+                            const string& password, Money initialDeposit) {
+    OpResult r;
+    if (name.empty() || name.size() > UINT16_MAX || mobile.size() != 10 || password.empty() || initialDeposit < 0 ||
+        initialDeposit > MONEY_MAX) {
+        r.status = OpStatus::Invalid;
+        return r;
+    }
+    if (journal.failed.load()) {
+        r.status = OpStatus::JournalFailed;
+        return r;
+    }
+    const string hash = hashPassword(password); // before the lock: it takes tens of milliseconds
+    unique_lock<shared_mutex> accounts(engineLocks.accounts);
+    r.user = createUser(db, name, mobile, hash, initialDeposit);
+    cacheCredential(*r.user, credentialTag(*r.user, password));
+    r.balance = initialDeposit;
+    CommitRecord rec;
+    rec.kind = TxKind::Open;
+    rec.amount = initialDeposit;
+    rec.delta = initialDeposit;
+    rec.users[0] = r.user;
+    rec.balances[0] = initialDeposit;
+    rec.opened = true;
+    r.tx = submitCommit(std::move(rec));
+    return r;
+}
+
+// type 1 = deposit, 2 = withdrawal
+static OpResult applyTransaction(BankDatabase* db, const string& accountNumber, const string& password,
+                                 Money amount, int type) {
+    OpResult r;
+    if (amount <= 0 || (type != 1 && type != 2)) {
+        r.status = OpStatus::Invalid;
+        return r;
+    }
+    if (journal.failed.load()) {
+        r.status = OpStatus::JournalFailed;
+        return r;
+    }
+    shared_lock<shared_mutex> accounts(engineLocks.accounts);
+    User* user = r.user = findUser(db, accountNumber);
+    if (!authenticateUser(user, password)) {
+        r.status = OpStatus::AuthFailed;
+        return r;
+    }
+    lock_guard<mutex> stripe(stripeFor(user));
+
+    CommitRecord rec;
+    if (type == 1) { // Deposit
+        if (user->balance > MONEY_MAX - amount) {
+            r.status = OpStatus::Invalid;
+            return r;
+        }
+        user->balance += amount;
+    } else { // Withdrawal
+        if (user->balance < amount) {
+            r.status = OpStatus::InsufficientFunds;
+            return r;
+        }
+        user->balance -= amount;
+    }
+    r.balance = user->balance;
+    rec.kind = type == 1 ? TxKind::Deposit : TxKind::Withdraw;
+    rec.amount = amount;
+    rec.delta = type == 1 ? amount : -amount;
+    rec.users[0] = user;
+    rec.balances[0] = user->balance;
+    r.tx = submitCommit(std::move(rec));
+    return r;
+}
+
+static OpResult transferFunds(BankDatabase* db, const string& fromAccount, const string& password,
+                              const string& toAccount, Money amount) {
+    OpResult r;
+    if (amount <= 0) {
+        r.status = OpStatus::Invalid;
+        return r;
+    }
+    if (journal.failed.load()) {
+        r.status = OpStatus::JournalFailed;
+        return r;
+    }
+    shared_lock<shared_mutex> accounts(engineLocks.accounts);
+    User* fromUser = r.user = findUser(db, fromAccount);
+    if (!authenticateUser(fromUser, password)) {
+        r.status = OpStatus::AuthFailed;
+        return r;
+    }
+    User* toUser = r.target = findUser(db, toAccount);
+    if (!toUser) {
+        r.status = OpStatus::NotFound;
+        return r;
+    }
+    // Both stripes in address order, so two opposite transfers cannot deadlock.
+    mutex* first = &stripeFor(fromUser);
+    mutex* second = &stripeFor(toUser);
+    if (second < first) swap(first, second);
+    lock_guard<mutex> lockFirst(*first);
+    unique_lock<mutex> lockSecond(*second, defer_lock);
+    if (second != first) lockSecond.lock();
+
+    if (fromUser->balance < amount) {
+        r.status = OpStatus::InsufficientFunds;
+        return r;
+    }
+    if (toUser != fromUser && toUser->balance > MONEY_MAX - amount) {
+        r.status = OpStatus::Invalid;
+        return r;
+    }
+    fromUser->balance -= amount;
+    toUser->balance += amount;
+    r.balance = fromUser->balance;
+
+    CommitRecord rec;
+    rec.kind = TxKind::Transfer;
+    rec.amount = amount;
+    rec.users[0] = fromUser;
+    rec.users[1] = toUser;
+    rec.balances[0] = fromUser->balance;
+    rec.balances[1] = toUser->balance;
+    r.tx = submitCommit(std::move(rec));
+    return r;
+}
+
+// Check the password once and open a session whose token can replace it.
+static OpResult login(BankDatabase* db, const string& accountNumber, const string& password) {
+    OpResult r;
+    shared_lock<shared_mutex> accounts(engineLocks.accounts);
+    r.user = findUser(db, accountNumber);
+    if (!authenticateUser(r.user, password)) {
+        r.status = OpStatus::AuthFailed;
+        return r;
+    }
+    r.token = openSession(r.user);
+    lock_guard<mutex> stripe(stripeFor(r.user));
+    r.balance = r.user->balance;
+    return r;
+}
+
+static OpResult logout(BankDatabase* db, const string& accountNumber, const string& token) {
+    OpResult r;
+    shared_lock<shared_mutex> accounts(engineLocks.accounts);
+    r.user = findUser(db, accountNumber);
+    if (!r.user || !closeSession(token, r.user)) {
+        r.status = OpStatus::AuthFailed;
+        return r;
+    }
+    lock_guard<mutex> stripe(stripeFor(r.user));
+    r.balance = r.user->balance;
+    return r;
+}
+
+// ---------- Batch mode ----------
+// Reads one command per line and writes one result line per command:
+//
+//   create,<name>,<mobile>,<password>,<amount>
+//   deposit,<account>,<password>,<amount>
+//   withdraw,<account>,<password>,<amount>
+//   transfer,<from>,<password>,<to>,<amount>
+//   login,<account>,<password>
+//   logout,<account>,<token>
+//
+//   => <line>,<status>,<transactionID|->,<account|->,<balance|->
+//
+// login answers with its session token in place of the transaction ID; the
+// token is accepted wherever a password is until logout or 30 idle minutes.
+// Blank lines and lines starting with '#' are skipped.
+//
+// With --threads N > 1 the input is read whole and cut into runs at create
+// lines, which execute alone so later commands can use the new account.
+// Each run is spread over the workers by the first account it names, so
+// commands on one account keep their order (a transfer's credit can still
+// interleave with the destination's own commands). Results keep input order.
+static unsigned batchThreads = 1;
+
+// Execute one command line and append its result line.
+static void runCommand(BankDatabase* db, const string& line, size_t lineNo, vector<string>& f, string& result) {
+    f.clear();
+    for (size_t pos = 0;;) {
+        size_t comma = line.find(',', pos);
+        f.emplace_back(line, pos, comma == string::npos ? string::npos : comma - pos);
+        if (comma == string::npos) break;
+        pos = comma + 1;
+    }
+
+    OpResult r;
+    r.status = OpStatus::Invalid;
+    Money amount = 0;
+    const string& cmd = f[0];
+    if (cmd == "create" && f.size() == 5 && parseMoney(f[4], amount))
+        r = openAccount(db, f[1], f[2], f[3], amount);
+    else if (cmd == "deposit" && f.size() == 4 && parseMoney(f[3], amount))
+        r = applyTransaction(db, f[1], f[2], amount, 1);
+    else if (cmd == "withdraw" && f.size() == 4 && parseMoney(f[3], amount))
+        r = applyTransaction(db, f[1], f[2], amount, 2);
+    else if (cmd == "transfer" && f.size() == 5 && parseMoney(f[4], amount))
+        r = transferFunds(db, f[1], f[2], f[3], amount);
+    else if (cmd == "login" && f.size() == 3)
+        r = login(db, f[1], f[2]);
+    else if (cmd == "logout" && f.size() == 3)
+        r = logout(db, f[1], f[2]);
+
+    result += to_string(lineNo);
+    result += ',';
+    result += opStatusName(r.status);
+    if (r.status == OpStatus::Ok) {
+        const bool session = cmd == "login" || cmd == "logout";
+        result += ',' + (session ? (r.token.empty() ? string("-") : r.token) : transactionID(r.tx));
+        result += ',' + r.user->accountNumber + ',';
+        appendMoney(result, r.balance);
+        result += '\n';
+    } else {
+        result += ",-,-,-\n";
+    }
+}
+
+static bool readCommand(istream& in, string& line, size_t& lineNo) {
+    while (getline(in, line)) {
+        ++lineNo;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (!line.empty() && line[0] != '#') return true;
+    }
+    return false;
+}
+
+static size_t runBatchParallel(BankDatabase* db, istream& in, ostream& out, unsigned threads) {
+    constexpr size_t MIN_PARALLEL_RUN = 256; // shorter runs are not worth starting workers for
+    vector<string> lines;
+    vector<size_t> lineNos;
+    string line;
+    for (size_t lineNo = 0; readCommand(in, line, lineNo);) {
+        lines.push_back(line);
+        lineNos.push_back(lineNo);
+    }
+    auto isCreate = [&](size_t k) { return lines[k].compare(0, 7, "create,") == 0; };
+    auto route = [&](size_t k) {
+        string_view v = lines[k];
+        size_t a = v.find(',') + 1, b = v.find(',', a);
+        return hash<string_view>{}(v.substr(a, b - a)) % threads;
+    };
+
+    vector<string> results(lines.size());
+    vector<vector<size_t>> queues(threads);
+    vector<string> f;
+    for (size_t i = 0; i < lines.size();) {
+        size_t j = i + 1;
+        if (!isCreate(i))
+            while (j < lines.size() && !isCreate(j)) ++j;
+        if (j - i < MIN_PARALLEL_RUN) {
+            for (size_t k = i; k < j; ++k) runCommand(db, lines[k], lineNos[k], f, results[k]);
+        } else {
+            for (auto& q : queues) q.clear();
+            for (size_t k = i; k < j; ++k) queues[route(k)].push_back(k);
+            vector<thread> pool;
+            for (unsigned t = 0; t < threads; ++t)
+                pool.emplace_back([&, t] {
+                    vector<string> fields;
+                    for (size_t k : queues[t]) runCommand(db, lines[k], lineNos[k], fields, results[k]);
+                });
+            for (auto& th : pool) th.join();
+        }
+        for (size_t k = i; k < j; ++k) {
+            out.write(results[k].data(), static_cast<streamsize>(results[k].size()));
+            string().swap(results[k]);
+        }
+        i = j;
+    }
+    out.flush();
+    return lines.size();
+}
+
+static size_t runBatch(BankDatabase* db, istream& in, ostream& out) {
+    if (batchThreads > 1) return runBatchParallel(db, in, out, batchThreads);
+    string line, result;
+    vector<string> f;
+    size_t lineNo = 0, processed = 0;
+    while (readCommand(in, line, lineNo)) {
+        runCommand(db, line, lineNo, f, result);
+        if (result.size() >= (1 << 16)) {
+            out.write(result.data(), static_cast<streamsize>(result.size()));
+            result.clear();
+        }
+        ++processed;
+    }
+    out.write(result.data(), static_cast<streamsize>(result.size()));
+    out.flush();
+    return processed;
+}
+
+// ---------- Server mode ----------
+// --serve runs the batch protocol over a socket: a client writes command
+// lines and reads one result line per command, in order, and may have any
+// number of commands in flight (pipelining). <line> in a result counts the
+// lines received on that connection. The address is host:port or :port for
+// TCP (IPv4, default host 127.0.0.1) or a path for a Unix domain socket.
+//
+// Each of --threads event loops owns an epoll instance and the connections
+// it accepts, never blocks on a socket, and runs commands inline on the
+// engine, except those that may run the password KDF (create, and a password
+// not yet cached). Those go to a pool of KDF workers; the connection is
+// parked, reading nothing and answering nothing more, until the worker hands
+// the result back through the loop's eventfd, so results keep their order.
+// SIGINT or SIGTERM stops the loops; the pipeline is then drained and the
+// journal synced as on any other exit.
+static constexpr size_t SERVER_MAX_LINE = 1 << 16;    // a longer request closes the connection
+static constexpr size_t SERVER_MAX_UNSENT = 1 << 20;  // stop reading while this many result bytes wait
+static constexpr int SERVER_ACCEPT_BATCH = 16;        // per wake-up, so other loops get a share
+
+struct SocketAddress {
+    sockaddr_storage addr{};
+    socklen_t len{0};
+    string path; // Unix domain socket path, empty for TCP
+};
+
+static bool parseSocketAddress(const string& s, SocketAddress& out) {
+    out = SocketAddress();
+    size_t colon = s.rfind(':');
+    if (colon == string::npos || s.find('/') != string::npos) {
+        auto* un = reinterpret_cast<sockaddr_un*>(&out.addr);
+        if (s.empty() || s.size() >= sizeof(un->sun_path)) return false;
+        un->sun_family = AF_UNIX;
+        memcpy(un->sun_path, s.c_str(), s.size() + 1);
+        out.len = sizeof(sockaddr_un);
+        out.path = s;
+        return true;
+    }
+    auto* in = reinterpret_cast<sockaddr_in*>(&out.addr);
+    string host = s.substr(0, colon);
+    if (host.empty() || host == "localhost") host = "127.0.0.1";
+    uint16_t port;
+    if (!parseInt(string_view(s).substr(colon + 1), port) || inet_pton(AF_INET, host.c_str(), &in->sin_addr) != 1)
+        return false;
+    in->sin_family = AF_INET;
+    in->sin_port = htons(port);
+    out.len = sizeof(sockaddr_in);
+    return true;
+}
+
+// Thousands of connections need more descriptors than the usual soft limit of 1024.
+static void raiseFileLimit() {
+    rlimit r;
+    if (getrlimit(RLIMIT_NOFILE, &r) == 0 && r.rlim_cur < r.rlim_max) {
+        r.rlim_cur = r.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &r);
+    }
+}
+
+struct ServerConnection {
+    int fd{-1};
+    string in, out;    // unparsed request bytes; results not yet sent from outPos on
+    size_t outPos{0};
+    size_t lines{0};
+    bool eof{false};   // the client has shut down its side
+    bool parked{false}; // a command is with the KDF workers
+    bool closed{false}; // closed while parked: freed when the command returns
+    uint32_t events{0};
+};
+
+struct ServerLoop;
+
+// A command handed to the KDF workers; the result comes back to `loop`.
+struct ServerJob {
+    ServerLoop* loop{nullptr};
+    ServerConnection* conn{nullptr};
+    string line, result;
+    size_t lineNo{0};
+};
+
+struct ServerLoop {
+    int wakeFd{-1}; // eventfd the workers signal when `done` has jobs
+    mutex m;
+    vector<unique_ptr<ServerJob>> done;
+};
+
+struct Server {
+    int listenFd{-1};
+    int stopFd{-1}; // eventfd, never read: once signalled it wakes every loop
+    atomic<uint64_t> accepted{0}, requests{0};
+    mutex jobsMutex;
+    condition_variable jobsReady;
+    deque<unique_ptr<ServerJob>> jobs;
+    bool stopping{false}; // under jobsMutex
+} server;
+
+static void stopServer(int) {
+    uint64_t one = 1;
+    if (write(server.stopFd, &one, sizeof(one)) < 0) { /* nothing to do in a signal handler */ }
+}
+
+static void watchConnection(int ep, ServerConnection& c, uint32_t want) {
+    if (want == c.events) return;
+    epoll_event ev{};
+    ev.events = want;
+    ev.data.ptr = &c;
+    epoll_ctl(ep, EPOLL_CTL_MOD, c.fd, &ev);
+    c.events = want;
+}
+
+// Whether a command line may run the password KDF: create always hashes,
+// and deposit, withdraw, transfer and login do unless the credential is cached.
+static bool commandNeedsKdf(BankDatabase* db, const string& line) {
+    string_view v = line;
+    size_t a = v.find(',');
+    if (a == string_view::npos) return false;
+    string_view cmd = v.substr(0, a);
+    if (cmd == "create") return true;
+    if (cmd != "deposit" && cmd != "withdraw" && cmd != "transfer" && cmd != "login") return false;
+    size_t b = v.find(',', a + 1);
+    if (b == string_view::npos) return false;
+    size_t c = min(v.find(',', b + 1), v.size());
+    shared_lock<shared_mutex> accounts(engineLocks.accounts);
+    User* user = findUser(db, string(v.substr(a + 1, b - a - 1)));
+    return !credentialCheap(user, string(v.substr(b + 1, c - b - 1)));
+}
+
+// Answer the complete lines buffered on the connection, in order, until one
+// has to go to the KDF workers; the lines after it wait in c.in.
+static void answerLines(BankDatabase* db, ServerLoop& loop, ServerConnection& c, string& line,
+                        vector<string>& fields) {
+    size_t pos = 0, answered = 0;
+    for (size_t nl; !c.parked && (nl = c.in.find('\n', pos)) != string::npos; pos = nl + 1) {
+        line.assign(c.in, pos, nl - pos);
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        ++c.lines;
+        if (line.empty() || line[0] == '#') continue;
+        if (commandNeedsKdf(db, line)) {
+            auto job = make_unique<ServerJob>();
+            job->loop = &loop;
+            job->conn = &c;
+            job->line = line;
+            job->lineNo = c.lines;
+            {
+                lock_guard<mutex> lock(server.jobsMutex);
+                server.jobs.push_back(std::move(job));
+            }
+            server.jobsReady.notify_one();
+            c.parked = true;
+            continue;
+        }
+        runCommand(db, line, c.lines, fields, c.out);
+        ++answered;
+    }
+    c.in.erase(0, pos);
+    if (answered) server.requests.fetch_add(answered, memory_order_relaxed);
+}
+
+// Read what has arrived, answer every complete line and send what the socket
+// takes. A parked connection reads nothing until its command returns; a hang-up
+// then closes it, as no result can reach the client. Returns false once the
+// connection should be closed.
+static bool serveConnection(BankDatabase* db, ServerLoop& loop, int ep, ServerConnection& c, uint32_t events,
+                            string& line, vector<string>& fields) {
+    if ((events & EPOLLERR) || (c.parked && (events & EPOLLHUP))) return false;
+    if ((events & (EPOLLIN | EPOLLHUP)) && !c.eof && !c.parked) {
+        char buf[1 << 16];
+        ssize_t got = read(c.fd, buf, sizeof(buf));
+        if (got > 0) c.in.append(buf, size_t(got));
+        else if (got == 0) c.eof = true;
+        else if (errno != EAGAIN && errno != EINTR) return false;
+    }
+    if (!c.parked) {
+        answerLines(db, loop, c, line, fields);
+        if (!c.parked && c.in.size() > SERVER_MAX_LINE) return false;
+    }
+    while (c.outPos < c.out.size()) {
+        ssize_t sent = send(c.fd, c.out.data() + c.outPos, c.out.size() - c.outPos, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EAGAIN || errno == EINTR) break;
+            return false;
+        }
+        c.outPos += size_t(sent);
+    }
+    if (c.outPos == c.out.size()) {
+        c.out.clear();
+        c.outPos = 0;
+    } else if (c.outPos >= SERVER_MAX_LINE && c.outPos * 2 >= c.out.size()) {
+        c.out.erase(0, c.outPos);
+        c.outPos = 0;
+    }
+    if (c.eof && c.out.empty() && !c.parked) return false;
+    bool reading = !c.eof && !c.parked && c.out.size() - c.outPos < SERVER_MAX_UNSENT;
+    watchConnection(ep, c, (reading ? EPOLLIN : 0u) | (c.outPos < c.out.size() ? EPOLLOUT : 0u));
+    return true;
+}
+
+static void acceptConnections(int ep, bool tcp, unordered_map<int, unique_ptr<ServerConnection>>& conns) {
+    for (int k = 0; k < SERVER_ACCEPT_BATCH; ++k) {
+        int fd = accept4(server.listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return; // EAGAIN: another loop took it, or none left
+        if (tcp) {
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+        auto c = make_unique<ServerConnection>();
+        c->fd = fd;
+        c->events = EPOLLIN;
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.ptr = c.get();
+        if (epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            close(fd);
+            continue;
+        }
+        conns[fd] = std::move(c);
+        server.accepted.fetch_add(1, memory_order_relaxed);
+    }
+}
+
+// Close a connection, or if its command is still with the workers stop
+// watching it and leave the close to finishCommands.
+static void closeConnection(int ep, unordered_map<int, unique_ptr<ServerConnection>>& conns, ServerConnection& c) {
+    if (c.parked) {
+        epoll_ctl(ep, EPOLL_CTL_DEL, c.fd, nullptr);
+        c.closed = true;
+        return;
+    }
+    int fd = c.fd;
+    close(fd);
+    conns.erase(fd);
+}
+
+// Take back the commands the workers have finished and resume their connections.
+static void finishCommands(BankDatabase* db, ServerLoop& loop, int ep,
+                           unordered_map<int, unique_ptr<ServerConnection>>& conns, string& line,
+                           vector<string>& fields) {
+    uint64_t count;
+    if (read(loop.wakeFd, &count, sizeof(count)) < 0) { /* EAGAIN: already drained */ }
+    vector<unique_ptr<ServerJob>> done;
+    {
+        lock_guard<mutex> lock(loop.m);
+        done.swap(loop.done);
+    }
+    server.requests.fetch_add(done.size(), memory_order_relaxed);
+    for (auto& job : done) {
+        ServerConnection& c = *job->conn;
+        c.parked = false;
+        if (c.closed) {
+            closeConnection(ep, conns, c);
+            continue;
+        }
+        c.out += job->result;
+        if (!serveConnection(db, loop, ep, c, 0, line, fields)) closeConnection(ep, conns, c);
+    }
+}
+
+// Run KDF-bound commands for the event loops until the server stops.
+static void serverWorker(BankDatabase* db) {
+    vector<string> fields;
+    for (;;) {
+        unique_ptr<ServerJob> job;
+        {
+            unique_lock<mutex> lock(server.jobsMutex);
+            server.jobsReady.wait(lock, [] { return server.stopping || !server.jobs.empty(); });
+            if (server.stopping) return; // the loops have closed every connection
+            job = std::move(server.jobs.front());
+            server.jobs.pop_front();
+        }
+        runCommand(db, job->line, job->lineNo, fields, job->result);
+        ServerLoop& loop = *job->loop;
+        {
+            lock_guard<mutex> lock(loop.m);
+            loop.done.push_back(std::move(job));
+        }
+        uint64_t one = 1;
+        if (write(loop.wakeFd, &one, sizeof(one)) < 0) { /* the counter cannot overflow in practice */ }
+    }
+}
+
+static void serverLoop(BankDatabase* db, ServerLoop* loop, bool tcp) {
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLEXCLUSIVE; // wake one loop per new connection, not all of them
+    ev.data.ptr = &server.listenFd;
+    epoll_ctl(ep, EPOLL_CTL_ADD, server.listenFd, &ev);
+    ev.events = EPOLLIN;
+    ev.data.ptr = &server.stopFd;
+    epoll_ctl(ep, EPOLL_CTL_ADD, server.stopFd, &ev);
+    ev.data.ptr = &loop->wakeFd;
+    epoll_ctl(ep, EPOLL_CTL_ADD, loop->wakeFd, &ev);
+
+    unordered_map<int, unique_ptr<ServerConnection>> conns;
+    string line;
+    vector<string> fields;
+    epoll_event events[256];
+    for (bool running = true; running;) {
+        int n = epoll_wait(ep, events, 256, -1);
+        for (int i = 0; i < n; ++i) {
+            void* tag = events[i].data.ptr;
+            if (tag == &server.stopFd) {
+                running = false;
+            } else if (tag == &server.listenFd) {
+                acceptConnections(ep, tcp, conns);
+            } else if (tag == &loop->wakeFd) {
+                finishCommands(db, *loop, ep, conns, line, fields);
+            } else {
+                auto* c = static_cast<ServerConnection*>(tag);
+                if (!serveConnection(db, *loop, ep, *c, events[i].events, line, fields))
+                    closeConnection(ep, conns, *c);
+            }
+        }
+    }
+    for (auto& [fd, c] : conns) close(fd);
+    close(ep);
+}
+
+// Listen on the address and serve until SIGINT or SIGTERM.
+static bool runServer(BankDatabase* db, const SocketAddress& addr, unsigned loops) {
+    const bool tcp = addr.path.empty();
+    raiseFileLimit();
+    server.listenFd = socket(addr.addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int one = 1;
+    if (tcp) setsockopt(server.listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    else unlink(addr.path.c_str()); // a socket file left by an earlier run
+    if (server.listenFd < 0 || bind(server.listenFd, reinterpret_cast<const sockaddr*>(&addr.addr), addr.len) != 0 ||
+        listen(server.listenFd, SOMAXCONN) != 0) {
+        cerr << "Failed to listen: " << strerror(errno) << "\n";
+        if (server.listenFd >= 0) close(server.listenFd);
+        return false;
+    }
+    server.stopFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    struct sigaction sa{};
+    sa.sa_handler = stopServer;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    cerr << "Serving on " << (tcp ? "TCP" : "Unix socket") << " with " << loops << " event loop"
+         << (loops == 1 ? "" : "s") << "; SIGINT or SIGTERM to stop\n";
+    auto start = chrono::steady_clock::now();
+    vector<unique_ptr<ServerLoop>> loopState;
+    vector<thread> pool, workers;
+    for (unsigned t = 0; t < max(1u, thread::hardware_concurrency()); ++t) workers.emplace_back(serverWorker, db);
+    for (unsigned t = 0; t < loops; ++t) {
+        loopState.push_back(make_unique<ServerLoop>());
+        loopState.back()->wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        pool.emplace_back(serverLoop, db, loopState.back().get(), tcp);
+    }
+    for (auto& th : pool) th.join();
+    {
+        lock_guard<mutex> lock(server.jobsMutex);
+        server.stopping = true;
+    }
+    server.jobsReady.notify_all();
+    for (auto& th : workers) th.join();
+    for (auto& l : loopState) close(l->wakeFd);
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    close(server.listenFd);
+    close(server.stopFd);
+    if (!tcp) unlink(addr.path.c_str());
+    cerr << "Served " << server.requests.load() << " commands on " << server.accepted.load() << " connections in "
+         << fixed << setprecision(3) << secs << " s\n";
+    return true;
+}
+
+// ---------- Interactive ops ----------
+// Read one amount token; anything unparsable becomes -1, which every operation rejects.
+static Money readAmount() {
+    string s;
+    Money m;
+    cin >> s;
+    return parseMoney(s, m) ? m : -1;
+}
+
+static void transaction(BankDatabase* db, const string& accountNumber, Money amount, int type) {
+    string password;
+    cout << "Enter password for account " << accountNumber << ": ";
+    cin >> password;
+
+    OpResult r = applyTransaction(db, accountNumber, password, amount, type);
+    switch (r.status) {
+        case OpStatus::Ok:
+            cout << "Rs." << moneyString(amount)
+                 << (type == 1 ? " deposited to Account #" : " withdrawn from Account #") << r.user->accountNumber
+                 << ". New Balance: Rs." << moneyString(r.balance) << "\n";
+            break;
+        case OpStatus::AuthFailed:
+            cout << "Authentication failed. Transaction aborted.\n";
+            break;
+        case OpStatus::InsufficientFunds:
+            cout << "Insufficient funds for withdrawal.\n";
+            break;
+        case OpStatus::JournalFailed:
+            cout << "The journal cannot be written; no changes are accepted until restart.\n";
+            break;
+        default:
+            cout << "Invalid transaction.\n";
+    }
+}
+
+static void transfer(BankDatabase* db, const string& fromAccount, const string& toAccount, Money amount) {
+    string password;
+    cout << "Enter password for account " << fromAccount << ": ";
+    cin >> password;
+
+    OpResult r = transferFunds(db, fromAccount, password, toAccount, amount);
+    switch (r.status) {
+        case OpStatus::Ok:
+            cout << "Rs." << moneyString(amount)
+                 << " transferred from Account #" << fromAccount
+                 << " to Account #" << toAccount << "\n";
+            break;
+        case OpStatus::AuthFailed:
+            cout << "Authentication failed. Transfer aborted.\n";
+            break;
+        case OpStatus::NotFound:
+            cout << "One or both account numbers not found.\n";
+            break;
+        case OpStatus::InsufficientFunds:
+            cout << "Insufficient funds in source account.\n";
+            break;
+        case OpStatus::JournalFailed:
+            cout << "The journal cannot be written; no changes are accepted until restart.\n";
+            break;
+        default:
+            cout << "Invalid transfer amount.\n";
+    }
+}
+
+// ---------- Menu ----------
+// Relative paths for portability
+static const string USERS_CSV = "users.csv";
+static const string TX_CSV = "transactions.csv";
+static const string LEDGER_BIN = "ledger.bin";
+static const string JOURNAL = "ledger.journal";
+static const string SNAPSHOT = "bank.snapshot";
+
+// Load the ledger and the accounts (from the snapshot when it is at least as
+// new as ledger.bin, else from users.csv), replay the journal, index account
+// history and per-transaction deltas after the snapshot, and start the commit
+// pipeline and snapshot worker. A snapshot whose head block is not on the
+// replayed chain is dropped and the load redone from users.csv. Plaintext
+// passwords from older files are hashed and the journal folded into the
+// bases at once, so no copy stays on disk in clear text.
+static void openBank(BankDatabase* db) {
+    initBankDatabase(db);
+    loadLedger(LEDGER_BIN, TX_CSV);
+    SnapshotInfo snap;
+    bool fromSnapshot = loadSnapshot(db, SNAPSHOT, snap) && snap.height >= blockchain.blocks.size();
+    if (!fromSnapshot) {
+        initBankDatabase(db);
+        loadUsersFromCSV(db, USERS_CSV);
+    }
+    openJournal(db, JOURNAL);
+    if (fromSnapshot && !snapshotMatchesChain(snap)) {
+        cerr << "Snapshot " << SNAPSHOT << " does not match the chain; loading " << USERS_CSV << "\n";
+        closeJournal();
+        initBankDatabase(db);
+        loadUsersFromCSV(db, USERS_CSV);
+        loadLedger(LEDGER_BIN, TX_CSV);
+        openJournal(db, JOURNAL);
+        fromSnapshot = false;
+    }
+    uint64_t firstTx = fromSnapshot ? snap.txCount : 0;
+    buildAccountHistory(db, firstTx);
+    buildLedgerDeltas(firstTx, fromSnapshot ? snap.ledgerTotal : 0);
+    snapshots.lastHeight = fromSnapshot ? snap.height : 0;
+    if (upgradePlaintextPasswords(db)) exportToCSV(db, USERS_CSV, LEDGER_BIN, TX_CSV, SNAPSHOT);
+    startPipeline();
+    startSnapshots(db, SNAPSHOT, USERS_CSV, LEDGER_BIN);
+}
+
+// Loaders for the read-only queries. They see what the bank would see, but
+// create or write nothing and start no threads.
+
+// ledger.bin, or transactions.csv parsed in memory.
+static void loadLedgerReadOnly(CsvLoad mode = CsvLoad::Reseal, CsvDefect* defect = nullptr) {
+    blockchain.blocks.clear();
+    blockchain.timeIndex = TimeIndex();
+    if (access(LEDGER_BIN.c_str(), F_OK) == 0) {
+        if (!openLedger(LEDGER_BIN)) cerr << "Reading an empty chain.\n";
+    } else if (access(TX_CSV.c_str(), F_OK) == 0) {
+        loadTransactionsFromCSV(TX_CSV, mode, defect);
+    }
+}
+
+// The chain and the journal.
+static void loadChainReadOnly(BankDatabase* db, CsvLoad mode = CsvLoad::Reseal, CsvDefect* defect = nullptr) {
+    initBankDatabase(db);
+    loadLedgerReadOnly(mode, defect);
+    readJournal(db, JOURNAL);
+}
+
+// The accounts as well, from the snapshot or users.csv, with their histories
+// and the ledger deltas; openBank without the side effects.
+static void loadBankReadOnly(BankDatabase* db, bool useSnapshot = true) {
+    initBankDatabase(db);
+    loadLedgerReadOnly();
+    SnapshotInfo snap;
+    bool fromSnapshot = useSnapshot && loadSnapshot(db, SNAPSHOT, snap) && snap.height >= blockchain.blocks.size();
+    if (!fromSnapshot) {
+        initBankDatabase(db);
+        if (access(USERS_CSV.c_str(), F_OK) == 0) loadUsersFromCSV(db, USERS_CSV);
+    }
+    readJournal(db, JOURNAL);
+    if (fromSnapshot && !snapshotMatchesChain(snap)) {
+        cerr << "Snapshot " << SNAPSHOT << " does not match the chain; reading " << USERS_CSV << "\n";
+        loadBankReadOnly(db, false);
+        return;
+    }
+    uint64_t firstTx = fromSnapshot ? snap.txCount : 0;
+    buildAccountHistory(db, firstTx);
+    buildLedgerDeltas(firstTx, fromSnapshot ? snap.ledgerTotal : 0);
+}
+
+static void menu() {
+    BankDatabase db;
+    openBank(&db);
+
+    int choice;
+    string accountNumber;
+    Money amount;
+    string name, mobile, password, confirmPassword;
+
+    do {
+        cout << "\n--- Bank Menu ---\n";
+        cout << "1. Create Account\n";
+        cout << "2. Deposit Money\n";
+        cout << "3. Withdraw Money\n";
+        cout << "4. Transfer Money\n";
+        cout << "5. View Accounts\n";
+        cout << "6. Verify Blockchain\n";
+        cout << "7. Export to CSV\n";
+        cout << "8. Look Up Transaction\n";
+        cout << "9. Account Statement\n";
+        cout << "10. Stats\n";
+        cout << "11. Transactions Between Times\n";
+        cout << "12. Exit\n";
+        cout << "Choose an option: ";
+        if (!(cin >> choice)) {
+            cin.clear();
+            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+            cout << "Invalid input.\n";
+            continue;
+        }
+
+        switch (choice) {
+            case 1: {
+                cout << "Enter name: ";
+                cin >> name; // single-token like original
+                cout << "Enter mobile number: ";
+                cin >> mobile;
+                if (mobile.size() != 10) {
+                    cout << "Error: Mobile number must be exactly 10 digits long.\n";
+                    break;
+                }
+                cout << "Create password: ";
+                cin >> password;
+                cout << "Confirm password: ";
+                cin >> confirmPassword;
+                if (password != confirmPassword) {
+                    cout << "Passwords do not match. Account creation failed.\n";
+                    break;
+                }
+                cout << "Initial deposit: ";
+                amount = readAmount();
+
+                OpResult r = openAccount(&db, name, mobile, password, amount);
+                if (r.status == OpStatus::Ok)
+                    cout << "Account created successfully. Account Number: " << r.user->accountNumber << "\n";
+                else if (r.status == OpStatus::JournalFailed)
+                    cout << "The journal cannot be written; no changes are accepted until restart.\n";
+                else
+                    cout << "Invalid initial deposit. Account creation failed.\n";
+                break;
+            }
+            case 2: {
+                cout << "Enter account number: ";
+                cin >> accountNumber;
+                cout << "Enter amount to deposit: ";
+                amount = readAmount();
+                transaction(&db, accountNumber, amount, 1);
+                break;
+            }
+            case 3: {
+                cout << "Enter account number: ";
+                cin >> accountNumber;
+                cout << "Enter amount to withdraw: ";
+                amount = readAmount();
+                transaction(&db, accountNumber, amount, 2);
+                break;
+            }
+            case 4: {
+                string toAccount;
+                cout << "Enter from account number: ";
+                cin >> accountNumber;
+                cout << "Enter to account number: ";
+                cin >> toAccount;
+                cout << "Enter amount to transfer: ";
+                amount = readAmount();
+                transfer(&db, accountNumber, toAccount, amount);
+                break;
+            }
+            case 5: {
+                size_t pages = (db.accounts.size() + ACCOUNTS_PAGE_SIZE - 1) / ACCOUNTS_PAGE_SIZE;
+                string more = "y";
+                for (size_t page = 0; more == "y" || more == "Y"; ++page) {
+                    printUsers(&db, page);
+                    if (page + 1 >= pages) break;
+                    cout << "Show next page? (y/n): ";
+                    cin >> more;
+                }
+                break;
+            }
+            case 6: {
+                auto quiet = drainPipeline();
+                printVerifyReport(verifyChain());
+                buildLedgerDeltas(); // audit the whole chain, not just what followed the snapshot
+                printReconcileReport(reconcile(&db));
+                break;
+            }
+            case 7:
+                if (exportToCSV(&db, USERS_CSV, LEDGER_BIN, TX_CSV, SNAPSHOT))
+                    cout << "Accounts and transactions exported to " << USERS_CSV << " and " << TX_CSV << ".\n";
+                break;
+            case 8: {
+                string id;
+                cout << "Enter transaction ID (e.g. TRX-42): ";
+                cin >> id;
+                auto quiet = drainPipeline();
+                printTransaction(id);
+                break;
+            }
+            case 9: {
+                cout << "Enter account number: ";
+                cin >> accountNumber;
+                cout << "Enter password: ";
+                cin >> password;
+                if (!authenticateUser(findUser(&db, accountNumber), password)) {
+                    cout << "Authentication failed.\n";
+                    break;
+                }
+                auto quiet = drainPipeline();
+                const User& u = *findUser(&db, accountNumber);
+                size_t pages = (u.history.size() + STATEMENT_PAGE_SIZE - 1) / STATEMENT_PAGE_SIZE;
+                string more = "y";
+                for (size_t page = 0; more == "y" || more == "Y"; ++page) {
+                    printStatement(u, page);
+                    if (page + 1 >= pages) break;
+                    cout << "Show next page? (y/n): ";
+                    cin >> more;
+                }
+                break;
+            }
+            case 10:
+                printStats(cout);
+                printPipelineStats(cout);
+                break;
+            case 11: {
+                string from, to;
+                int64_t fromTs, toTs;
+                cin.ignore(numeric_limits<streamsize>::max(), '\n');
+                cout << "From (Unix time or YYYY-MM-DD HH:MM:SS): ";
+                getline(cin, from);
+                cout << "To (Unix time or YYYY-MM-DD HH:MM:SS): ";
+                getline(cin, to);
+                if (!parseTimestamp(from, fromTs) || !parseTimestamp(to, toTs)) {
+                    cout << "Invalid time.\n";
+                    break;
+                }
+                auto quiet = drainPipeline();
+                string more = "y";
+                for (size_t page = 0; more == "y" || more == "Y"; ++page) {
+                    if (page + 1 >= printTimeRange(fromTs, toTs, page)) break;
+                    cout << "Show next page? (y/n): ";
+                    cin >> more;
+                }
+                break;
+            }
+            case 12:
+                cout << "Exiting and syncing journal...\n";
+                sealAndFlush();
+                closeJournal();
+                cout << "Data saved. Exiting program.\n";
+                break;
+            default:
+                cout << "Invalid option.\n";
+        }
+    } while (choice != 12);
+}
+
+// The number after a command-line option; anything else, or a value outside
+// [lo, hi], is a usage error.
+template <typename T>
+static bool parseOption(const string& option, const string& text, T lo, T hi, T& out) {
+    if (parseInt(text, out) && out >= lo && out <= hi) return true;
+    cerr << option << " expects a number ";
+    if (hi == numeric_limits<T>::max()) cerr << "of at least " << lo;
+    else cerr << "from " << lo << " to " << hi;
+    cerr << ", not '" << text << "'\n";
+    return false;
+}
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        string next = i + 1 < argc ? argv[i + 1] : "";
+        if (arg == "--threads" && !next.empty()) {
+            // Worker threads for --batch and event loops for --serve (default 1); combine with other modes.
+            if (!parseOption(arg, next, 1u, 1024u, batchThreads)) return 1;
+            ++i;
+            continue;
+        }
+        if (arg == "--kdf-cost" && !next.empty()) {
+            // log2 of the scrypt cost for new password hashes (default 14); combine with other modes.
+            if (!parseOption(arg, next, 1u, 24u, kdfParams.logN)) return 1;
+            ++i;
+            continue;
+        }
+        if (arg == "--snapshot-blocks" && !next.empty()) {
+            // Checkpoint and snapshot every N sealed blocks (default 1024); combine with other modes.
+            if (!parseOption(arg, next, uint64_t(1), UINT64_MAX, snapshots.everyBlocks)) return 1;
+            ++i;
+            continue;
+        }
+        if (arg == "--stats-interval" && !next.empty()) {
+            // Seconds between --stats-file dumps (default 10); give it before --stats-file.
+            int64_t seconds;
+            if (!parseOption(arg, next, int64_t(1), INT64_MAX, seconds)) return 1;
+            statsDumper.interval = chrono::seconds(seconds);
+            ++i;
+            continue;
+        }
+        if (arg == "--stats-file" && !next.empty()) {
+            // Append a JSON line of hot-path stats to a file periodically and on exit; combine with other modes.
+            startStatsDump(next);
+            ++i;
+            continue;
+        }
+        if (arg == "--block-txs" && !next.empty()) {
+            // Seal a block every N transactions (default 256); combine with other modes.
+            if (!parseOption(arg, next, size_t(1), SIZE_MAX, blockchain.policy.maxTxs)) return 1;
+            ++i;
+            continue;
+        }
+        if (arg == "--verify") {
+            // Headless audit: load the ledger, verify it and exit non-zero on a broken chain.
+            // A CSV is checked as written: a legacy or damaged file is reported, never re-sealed.
+            CsvDefect defect;
+            if (next.empty()) {
+                BankDatabase db;
+                loadChainReadOnly(&db, CsvLoad::AsStored, &defect);
+            } else if (next.size() > 4 && next.compare(next.size() - 4, 4, ".csv") == 0) {
+                if (!loadTransactionsFromCSV(next, CsvLoad::AsStored, &defect)) return 1;
+            } else if (!openLedger(next)) {
+                return 1;
+            }
+            return verifyLoaded(defect) ? 0 : 1;
+        }
+        if (arg == "--lookup" && !next.empty()) {
+            // Print one transaction and the block sealing it: --lookup <TRX-n>
+            BankDatabase db;
+            loadChainReadOnly(&db);
+            printTransaction(next);
+            return 0;
+        }
+        if (arg == "--range" && i + 2 < argc) {
+            // Transactions sealed between two times, oldest first: --range <from> <to> [page]
+            int64_t from, to;
+            if (!parseTimestamp(next, from) || !parseTimestamp(argv[i + 2], to)) {
+                cerr << "Invalid time: use Unix seconds or YYYY-MM-DD[ HH:MM:SS]\n";
+                return 1;
+            }
+            size_t page = 1;
+            if (i + 3 < argc && !parseOption("--range page", argv[i + 3], size_t(1), SIZE_MAX, page)) return 1;
+            BankDatabase db;
+            loadChainReadOnly(&db);
+            printTimeRange(from, to, page - 1);
+            return 0;
+        }
+        if (arg == "--reconcile") {
+            // Check that account balances add up to the ledger's deposits and withdrawals.
+            BankDatabase db;
+            loadBankReadOnly(&db);
+            buildLedgerDeltas(); // the whole chain, not just what followed the snapshot
+            return printReconcileReport(reconcile(&db)) ? 0 : 1;
+        }
+        if (arg == "--statement" && !next.empty()) {
+            // Account statement, newest first: --statement <account> [page]
+            size_t page = 1;
+            if (i + 2 < argc && !parseOption("--statement page", argv[i + 2], size_t(1), SIZE_MAX, page)) return 1;
+            BankDatabase db;
+            loadBankReadOnly(&db);
+            User* u = findUser(&db, next);
+            if (!u) {
+                cerr << "Account " << next << " not found\n";
+                return 1;
+            }
+            printStatement(*u, page - 1);
+            return 0;
+        }
+        if (arg == "--prove" && !next.empty()) {
+            // Inclusion proof for one transaction: --prove <TRX-n> [proof.txt]
+            BankDatabase db;
+            loadChainReadOnly(&db);
+            uint64_t tx;
+            MerkleProof proof;
+            if (!parseTransactionID(next, tx)) {
+                cerr << "Invalid transaction ID: " << next << "\n";
+                return 1;
+            }
+            if (!buildMerkleProof(tx, proof)) {
+                cerr << transactionID(tx) << (tx < blockchain.blocks.txCount() ? " is not sealed yet\n" : " not found\n");
+                return 1;
+            }
+            if (i + 2 < argc) {
+                ofstream out(argv[i + 2]);
+                writeMerkleProof(out, proof);
+                if (!out) {
+                    cerr << "Failed to write " << argv[i + 2] << "\n";
+                    return 1;
+                }
+            } else {
+                writeMerkleProof(cout, proof);
+            }
+            return 0;
+        }
+        if (arg == "--check-proof" && !next.empty()) {
+            // Standalone proof check, no ledger needed: --check-proof <proof.txt> [trusted block hash]
+            ifstream in(next);
+            MerkleProof proof;
+            string reason;
+            Hash256 trusted;
+            if (!in || !readMerkleProof(in, proof)) {
+                cerr << "Failed to read proof: " << next << "\n";
+                return 1;
+            }
+            if (!checkMerkleProof(proof, reason)) {
+                cout << "Proof INVALID for " << transactionID(proof.tx) << ": " << reason << "\n";
+                return 1;
+            }
+            if (i + 2 < argc && (!parseHex(argv[i + 2], trusted) || trusted != proof.block.hash)) {
+                cout << "Proof INVALID for " << transactionID(proof.tx) << ": block hash is not the trusted hash\n";
+                return 1;
+            }
+            cout << "Proof valid: " << transactionID(proof.tx) << " is in block " << proof.block.index
+                 << " (hash " << toHex(proof.block.hash) << ", " << proof.siblings.size() << " sibling hashes)\n";
+            return 0;
+        }
+        if (arg == "--batch") {
+            // Headless engine: --batch [commands.csv | -] reads commands, writes results to stdout.
+            ios::sync_with_stdio(false);
+            ifstream file;
+            bool useStdin = next.empty() || next == "-";
+            if (!useStdin) {
+                file.open(next);
+                if (!file) {
+                    cerr << "Failed to open file: " << next << "\n";
+                    return 1;
+                }
+            }
+            BankDatabase db;
+            openBank(&db);
+            auto start = chrono::steady_clock::now();
+            size_t n = runBatch(&db, useStdin ? static_cast<istream&>(cin) : file, cout);
+            sealAndFlush();
+            closeJournal();
+            double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            cerr << "Processed " << n << " commands in " << fixed << setprecision(3) << secs << " s ("
+                 << setprecision(0) << (secs > 0 ? n / secs : 0) << " ops/sec, " << batchThreads << " threads)\n";
+            printReconcileReport(reconcile(&db), cerr);
+            printPipelineStats(cerr);
+            return 0;
+        }
+        if (arg == "--serve" && !next.empty()) {
+            // Batch protocol over a socket: --serve <host:port | :port | socket path> (loops from --threads).
+            SocketAddress addr;
+            if (!parseSocketAddress(next, addr)) {
+                cerr << "Invalid address: " << next << " (use host:port, :port or a socket path)\n";
+                return 1;
+            }
+            BankDatabase db;
+            openBank(&db);
+            bool ok = runServer(&db, addr, batchThreads);
+            sealAndFlush();
+            closeJournal();
+            printReconcileReport(reconcile(&db), cerr);
+            printPipelineStats(cerr);
+            return ok ? 0 : 1;
+        }
+        if (arg == "--import-csv" && !next.empty()) {
+            // Convert a CSV ledger into the binary format: --import-csv <csv> [ledger.bin]
+            if (!loadTransactionsFromCSV(next, CsvLoad::Reseal)) return 1;
+            string out = i + 2 < argc ? argv[i + 2] : LEDGER_BIN;
+            if (!writeLedger(out)) return 1;
+            cout << "Wrote " << blockchain.blocks.size() << " blocks to " << out << "\n";
+            return 0;
+        }
+        if (arg == "--export-csv" && !next.empty()) {
+            // Convert a binary ledger back to CSV: --export-csv <ledger.bin> [csv]
+            if (!openLedger(next)) return 1;
+            string out = i + 2 < argc ? argv[i + 2] : TX_CSV;
+            if (!saveTransactionsToCSV(out)) return 1;
+            cout << "Wrote " << blockchain.blocks.size() << " blocks to " << out << "\n";
+            return 0;
+        }
+    }
+    menu();
+    return 0;
+}
@@ -1,65 +1,400 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-
-typedef struct Block {
-    int index;
-    char transactionID[65];
-    char previousHash[65];
-    char timestamp[64];
-    char data[1024];
-    char hash[65];
-    struct Block *next;
-} Block;
-
-Block *blockchain = NULL;
-
-void loadTransactionsFromCSV(const char *filename) {
-    FILE *file = fopen(filename, "r");
-    if (!file) {
-        printf("Failed to open file %s\n", filename);
-        return;
-    }
-
-    char line[2048];
-    fgets(line, sizeof(line), file); // Skip header
-    Block *lastBlock = NULL;
-
-    while (fgets(line, sizeof(line), file) != NULL) {
-        Block *newBlock = (Block *)malloc(sizeof(Block));
-        sscanf(line, "%d,%[^,],%[^,],%[^,],%[^,],%s",
-               &newBlock->index, newBlock->transactionID, newBlock->previousHash,
-               newBlock->timestamp, newBlock->data, newBlock->hash);
-        newBlock->next = NULL;
-
-        if (lastBlock != NULL) {
-            lastBlock->next = newBlock;
-        } else {
-            blockchain = newBlock;
-        }
-        lastBlock = newBlock;
-    }
-    fclose(file);
-}
-
-void printBlockchain() {
-    printf("Blockchain Visualization:\n\n");
-    Block *current = blockchain;
-    while (current != NULL) {
-        printf("Block Index: %d\n", current->index);
-        printf("Transaction ID: %s\n", current->transactionID);
-        printf("Previous Hash: %s\n", current->previousHash);
-        printf("Timestamp: %s\n", current->timestamp);
-        printf("Data: %s\n", current->data);
-        printf("Hash: %s\n", current->hash);
-        printf("\n-------------------------------------\n");
-        current = current->next;
-    }
-}
-
-int main() {
-    const char *transactionsFilename = "D:\\YASH\\COLLEGE\\ADS\\CP\\Banking System using Blockchain\\transactions.csv";
-    loadTransactionsFromCSV(transactionsFilename);
-    printBlockchain();
-    return 0;
-}
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _WIN32
+#include <io.h>
+#define isatty _isatty
+#define fileno _fileno
+#define fseek64 _fseeki64
+#else
+#include <unistd.h>
+#define fseek64 fseeko
+#endif
+
+/* Ledger explorer. Blocks are streamed, never loaded as a whole, so memory
+   stays constant whatever the size of the ledger:
+
+     adscp2 [ledger.bin | transactions.csv] [--block N] [--from TIME] [--to TIME]
+            [--account ACC] [--type open|deposit|withdraw|transfer]
+            [--count N] [--page N]
+
+   ledger.bin is read through its header table: --block N seeks straight to
+   block N, a time range binary-searches the 128-byte block headers for its
+   first block (timestamps never decrease) and stops at the first block past
+   its end, and a transaction's payload is read only when its block matches. A CSV ledger
+   is read one row at a time. TIME is a Unix timestamp or YYYY-MM-DD[
+   HH:MM:SS] in local time. Output stops after --count transactions and, on
+   a terminal, pauses every --page transactions (default 20).
+   ledger.bin holds what the bank last exported; newer operations are still
+   in its journal. */
+
+#define BLOCK_HEADER_SIZE 128
+#define TX_RECORD_TAG 0x01
+#define TX_RECORD_HEADER 32
+
+typedef struct Block {
+    long long index;
+    long long timestamp;
+    unsigned long long firstTx;
+    unsigned long long txCount; /* 0 when unknown (CSV rows) */
+    char previousHash[65];
+    char hash[65];
+} Block;
+
+typedef struct Filter {
+    long long firstBlock;
+    long long from, to;
+    const char *account;
+    const char *type;
+    unsigned long long count;
+    unsigned long long page;
+} Filter;
+
+typedef struct Output {
+    unsigned long long printed;
+    long long lastBlock;
+    int interactive;
+    int stop;
+} Output;
+
+/* Grow-only scratch buffer, sized by the largest row or payload seen. */
+typedef struct Buffer {
+    char *data;
+    size_t size, capacity;
+} Buffer;
+
+int reserve(Buffer *b, size_t n) {
+    if (n <= b->capacity) return 1;
+    size_t cap = b->capacity ? b->capacity : 256;
+    while (cap < n) cap *= 2;
+    char *grown = (char *)realloc(b->data, cap);
+    if (!grown) return 0;
+    b->data = grown;
+    b->capacity = cap;
+    return 1;
+}
+
+int appendBytes(Buffer *b, const char *s, size_t n) {
+    if (!reserve(b, b->size + n + 1)) return 0;
+    memcpy(b->data + b->size, s, n);
+    b->size += n;
+    b->data[b->size] = '\0';
+    return 1;
+}
+
+int appendText(Buffer *b, const char *s) { return appendBytes(b, s, strlen(s)); }
+
+void appendMoney(Buffer *b, long long paise) {
+    char buf[32];
+    unsigned long long u = paise < 0 ? 0ULL - (unsigned long long)paise : (unsigned long long)paise;
+    snprintf(buf, sizeof(buf), "%s%llu.%02llu", paise < 0 ? "-" : "", u / 100, u % 100);
+    appendText(b, buf);
+}
+
+unsigned long long readLE64(const unsigned char *p) {
+    unsigned long long v = 0;
+    for (int k = 7; k >= 0; k--) v = v << 8 | p[k];
+    return v;
+}
+
+void toHex(const unsigned char *p, char *out) {
+    static const char digits[] = "0123456789abcdef";
+    for (int i = 0; i < 32; i++) {
+        out[2 * i] = digits[p[i] >> 4];
+        out[2 * i + 1] = digits[p[i] & 15];
+    }
+    out[64] = '\0';
+}
+
+/* Render a stored transaction as text: binary records in the same words the
+   bank uses, text transactions as they are. */
+void renderTransaction(const unsigned char *p, size_t n, Buffer *out) {
+    out->size = 0;
+    appendText(out, "");
+    if (n < TX_RECORD_HEADER || p[0] != TX_RECORD_TAG || p[1] < 1 || p[1] > 4 ||
+        TX_RECORD_HEADER + (p[2] | (size_t)p[3] << 8) + (p[4] | (size_t)p[5] << 8) != n) {
+        appendBytes(out, (const char *)p, n);
+        return;
+    }
+    size_t fromLen = p[2] | (size_t)p[3] << 8, toLen = p[4] | (size_t)p[5] << 8;
+    const char *from = (const char *)p + TX_RECORD_HEADER, *to = from + fromLen;
+    long long amount = (long long)readLE64(p + 8), balance = (long long)readLE64(p + 16);
+    switch (p[1]) {
+        case 1:
+            appendText(out, "Created account for ");
+            appendBytes(out, to, toLen);
+            appendText(out, " with initial deposit of Rs.");
+            appendMoney(out, amount);
+            appendText(out, ". Account Number: ");
+            appendBytes(out, from, fromLen);
+            break;
+        case 2:
+        case 3:
+            appendText(out, p[1] == 2 ? "Deposited Rs." : "Withdrawn Rs.");
+            appendMoney(out, amount);
+            appendText(out, p[1] == 2 ? " to " : " from ");
+            appendBytes(out, from, fromLen);
+            appendText(out, ". New Balance: Rs.");
+            appendMoney(out, balance);
+            break;
+        default:
+            appendText(out, "Transferred Rs.");
+            appendMoney(out, amount);
+            appendText(out, " from ");
+            appendBytes(out, from, fromLen);
+            appendText(out, " to ");
+            appendBytes(out, to, toLen);
+    }
+}
+
+const char *transactionType(const char *text) {
+    if (strncmp(text, "Created account", 15) == 0) return "open";
+    if (strncmp(text, "Deposited", 9) == 0) return "deposit";
+    if (strncmp(text, "Withdrawn", 9) == 0) return "withdraw";
+    if (strncmp(text, "Transferred", 11) == 0) return "transfer";
+    return "other";
+}
+
+/* True if `account` appears in the text as a whole word. */
+int mentionsAccount(const char *text, const char *account) {
+    size_t n = strlen(account);
+    for (const char *p = strstr(text, account); p; p = strstr(p + 1, account))
+        if ((p == text || !isalnum((unsigned char)p[-1])) && !isalnum((unsigned char)p[n])) return 1;
+    return 0;
+}
+
+int blockInRange(const Block *b, const Filter *f) {
+    return b->index >= f->firstBlock && b->timestamp >= f->from && b->timestamp <= f->to;
+}
+
+/* Print one transaction if it passes the filters; pauses between pages on a terminal. */
+void showTransaction(const Block *b, const char *id, const char *text, const Filter *f, Output *out) {
+    if (out->printed >= f->count) {
+        out->stop = 1;
+        return;
+    }
+    if (f->type && strcmp(transactionType(text), f->type) != 0) return;
+    if (f->account && !mentionsAccount(text, f->account)) return;
+    if (out->printed && out->interactive && out->printed % f->page == 0) {
+        char answer[16];
+        printf("-- more: Enter for the next page, q to quit -- ");
+        fflush(stdout);
+        if (!fgets(answer, sizeof(answer), stdin) || answer[0] == 'q' || answer[0] == 'Q') {
+            out->stop = 1;
+            return;
+        }
+    }
+    if (b->index != out->lastBlock) {
+        char when[32];
+        time_t ts = (time_t)b->timestamp;
+        struct tm *tm = localtime(&ts);
+        if (!tm || !strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", tm)) snprintf(when, sizeof(when), "%lld", b->timestamp);
+        printf("\nBlock %lld  %s", b->index, when);
+        if (b->txCount) printf("  (%llu transactions)", b->txCount);
+        printf("\n  Hash:          %s\n  Previous Hash: %s\n", b->hash, b->previousHash);
+        out->lastBlock = b->index;
+    }
+    printf("  %-12s %s\n", id, text);
+    if (++out->printed >= f->count) out->stop = 1;
+}
+
+/* ---------- ledger.bin ---------- */
+
+int readAt(FILE *file, unsigned long long offset, void *out, size_t n) {
+    return fseek64(file, (long long)offset, SEEK_SET) == 0 && fread(out, 1, n, file) == n;
+}
+
+int exploreLedger(const char *filename, const Filter *f, Output *out) {
+    /* Two handles: one streams the header table, the other seeks for payloads. */
+    FILE *headers = fopen(filename, "rb"), *payloads = fopen(filename, "rb");
+    unsigned char fh[64], raw[BLOCK_HEADER_SIZE], offsets[16];
+    Buffer payload = {0}, text = {0};
+    int ok = 0;
+    if (!headers || !payloads || !readAt(headers, 0, fh, sizeof(fh)) || memcmp(fh, "BCLEDGER", 8) != 0 ||
+        (fh[8] | fh[9] << 8) != 2 || (fh[12] | fh[13] << 8) != BLOCK_HEADER_SIZE) {
+        printf("%s is not a version 2 ledger.bin\n", filename);
+        goto done;
+    }
+    unsigned long long blockCount = readLE64(fh + 16), headersOffset = readLE64(fh + 32);
+    unsigned long long txOffsets = readLE64(fh + 40), payloadOffset = readLE64(fh + 48);
+    unsigned long long first = f->firstBlock > 0 ? (unsigned long long)f->firstBlock : 0;
+    for (unsigned long long hi = blockCount; f->from != LLONG_MIN && first < hi;) {
+        unsigned long long mid = first + (hi - first) / 2;
+        unsigned char stamp[8];
+        if (!readAt(headers, headersOffset + mid * BLOCK_HEADER_SIZE + 8, stamp, sizeof(stamp))) {
+            printf("Truncated block header %llu\n", mid);
+            goto done;
+        }
+        if ((long long)readLE64(stamp) < f->from) first = mid + 1;
+        else hi = mid;
+    }
+    if (first < blockCount && fseek64(headers, (long long)(headersOffset + first * BLOCK_HEADER_SIZE), SEEK_SET) != 0)
+        goto done;
+    for (unsigned long long i = first; i < blockCount && !out->stop; i++) {
+        if (fread(raw, 1, sizeof(raw), headers) != sizeof(raw)) {
+            printf("Truncated block header %llu\n", i);
+            goto done;
+        }
+        Block b;
+        b.index = (long long)readLE64(raw);
+        b.timestamp = (long long)readLE64(raw + 8);
+        if (b.timestamp > f->to) break;
+        if (!blockInRange(&b, f)) continue;
+        b.firstTx = readLE64(raw + 16);
+        b.txCount = readLE64(raw + 24);
+        toHex(raw + 32, b.previousHash);
+        toHex(raw + 96, b.hash);
+        for (unsigned long long n = b.firstTx; n < b.firstTx + b.txCount && !out->stop; n++) {
+            if (!readAt(payloads, txOffsets + n * 8, offsets, sizeof(offsets))) goto done;
+            unsigned long long lo = readLE64(offsets), hi = readLE64(offsets + 8);
+            if (hi < lo || !reserve(&payload, (size_t)(hi - lo) + 1) ||
+                !readAt(payloads, payloadOffset + lo, payload.data, (size_t)(hi - lo))) {
+                printf("Unreadable transaction TRX-%llu\n", n);
+                goto done;
+            }
+            char id[32];
+            snprintf(id, sizeof(id), "TRX-%llu", n);
+            renderTransaction((const unsigned char *)payload.data, (size_t)(hi - lo), &text);
+            showTransaction(&b, id, text.data, f, out);
+        }
+    }
+    ok = 1;
+done:
+    if (headers) fclose(headers);
+    if (payloads) fclose(payloads);
+    free(payload.data);
+    free(text.data);
+    return ok;
+}
+
+/* ---------- transactions.csv ---------- */
+
+/* Read one CSV record (quoted fields may span lines) into `row`, with
+   fields split in place and unquoted. Returns the field count, 0 at EOF. */
+size_t readCsvRow(FILE *file, Buffer *row, char **fields, size_t maxFields) {
+    row->size = 0;
+    int quoted = 0, c;
+    while ((c = fgetc(file)) != EOF) {
+        if (c == '"') quoted = !quoted;
+        if (c == '\n' && !quoted) break;
+        char ch = (char)c;
+        if (!appendBytes(row, &ch, 1)) return 0;
+    }
+    if (c == EOF && row->size == 0) return 0;
+    if (!appendText(row, "")) return 0;
+    if (row->size && row->data[row->size - 1] == '\r') row->data[--row->size] = '\0';
+
+    size_t n = 0;
+    char *w = row->data;
+    for (const char *r = row->data; n < maxFields;) {
+        fields[n++] = w;
+        if (*r == '"') {
+            for (r++; *r; r++) {
+                if (*r == '"' && r[1] == '"') *w++ = *r++;
+                else if (*r == '"') { r++; break; }
+                else *w++ = *r;
+            }
+        }
+        while (*r && *r != ',') *w++ = *r++;
+        char delimiter = *r++;
+        *w++ = '\0'; /* w never passes r, so this may overwrite the comma just read */
+        if (delimiter != ',') break;
+    }
+    return n;
+}
+
+int exploreCsv(const char *filename, const Filter *f, Output *out) {
+    FILE *file = fopen(filename, "rb");
+    if (!file) {
+        printf("Failed to open file %s\n", filename);
+        return 0;
+    }
+    Buffer row = {0};
+    char *fields[7];
+    readCsvRow(file, &row, fields, 7); /* header */
+    size_t n;
+    while (!out->stop && (n = readCsvRow(file, &row, fields, 7)) != 0) {
+        if (n < 6) continue;
+        Block b = {0};
+        b.index = atoll(fields[0]);
+        b.timestamp = atoll(fields[3]);
+        if (!blockInRange(&b, f)) continue;
+        snprintf(b.previousHash, sizeof(b.previousHash), "%s", fields[2]);
+        snprintf(b.hash, sizeof(b.hash), "%s", fields[5]);
+        showTransaction(&b, fields[1], fields[4], f, out);
+    }
+    fclose(file);
+    free(row.data);
+    return 1;
+}
+
+/* Unix seconds, or YYYY-MM-DD[ HH:MM:SS] / YYYY-MM-DDTHH:MM:SS in local time. */
+int parseTime(const char *s, long long *out) {
+    struct tm tm = {0};
+    char *end;
+    long long v = strtoll(s, &end, 10);
+    if (*s && !*end) {
+        *out = v;
+        return 1;
+    }
+    int fields = sscanf(s, "%d-%d-%d%*c%d:%d:%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday, &tm.tm_hour, &tm.tm_min, &tm.tm_sec);
+    if (fields != 3 && fields != 6) return 0;
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    tm.tm_isdst = -1;
+    *out = (long long)mktime(&tm);
+    return 1;
+}
+
+/* A whole decimal number up to `max`; signs, blanks and trailing text are rejected. */
+int parseNumber(const char *s, unsigned long long max, unsigned long long *out) {
+    char *end;
+    if (!isdigit((unsigned char)*s)) return 0;
+    errno = 0;
+    *out = strtoull(s, &end, 10);
+    return !*end && errno == 0 && *out <= max;
+}
+
+int main(int argc, char **argv) {
+    const char *filename = NULL;
+    Filter f = {0, LLONG_MIN, LLONG_MAX, NULL, NULL, ULLONG_MAX, 20};
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i], *next = i + 1 < argc ? argv[i + 1] : NULL;
+        unsigned long long block = 0;
+        int ok = 1;
+        if (arg[0] != '-') filename = arg;
+        else if (!next) ok = 0;
+        else if (strcmp(arg, "--block") == 0) ok = parseNumber(next, LLONG_MAX, &block), f.firstBlock = (long long)block, i++;
+        else if (strcmp(arg, "--from") == 0) ok = parseTime(next, &f.from), i++;
+        else if (strcmp(arg, "--to") == 0) ok = parseTime(next, &f.to), i++;
+        else if (strcmp(arg, "--account") == 0) f.account = next, i++;
+        else if (strcmp(arg, "--type") == 0) f.type = next, i++;
+        else if (strcmp(arg, "--count") == 0) ok = parseNumber(next, ULLONG_MAX, &f.count), i++;
+        else if (strcmp(arg, "--page") == 0) ok = parseNumber(next, ULLONG_MAX, &f.page), i++;
+        else ok = 0;
+        if (!ok || !f.page) {
+            printf("Usage: %s [ledger.bin | transactions.csv] [--block N] [--from TIME] [--to TIME]\n"
+                   "       [--account ACC] [--type open|deposit|withdraw|transfer] [--count N] [--page N]\n",
+                   argv[0]);
+            return 1;
+        }
+    }
+    if (!filename) {
+        FILE *probe = fopen("ledger.bin", "rb");
+        filename = probe ? "ledger.bin" : "transactions.csv";
+        if (probe) fclose(probe);
+    }
+
+    Output out = {0, -1, isatty(fileno(stdin)) && isatty(fileno(stdout)), 0};
+    size_t len = strlen(filename);
+    int csv = len >= 4 && strcmp(filename + len - 4, ".csv") == 0;
+    printf("Blockchain Visualization: %s\n", filename);
+    int ok = csv ? exploreCsv(filename, &f, &out) : exploreLedger(filename, &f, &out);
+    if (ok && !out.printed) printf("No matching transactions.\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,401 @@
+// Microbenchmarks for the ledger hot paths. The program is compiled in with
+// its main() renamed, so every benchmark calls the real functions:
+//
+//   g++ -std=c++17 -O2 -pthread benchmark.cpp -o benchmark
+//   ./benchmark [--sizes 1000,10000,100000,1000000] [--filter name] [--dir /tmp] [--min-time 0.2]
+//
+// Output is JSON Lines on stdout: one "machine" record, then one record per
+// benchmark and size with ns/op, ops/sec and heap allocations per op.
+#define main bankMain
+#include "BankingSystemusingBlockchain.cpp"
+#undef main
+
+// ---------- Allocation counting ----------
+// Every operator new in the process goes through here; the array and
+// nothrow forms forward to it.
+static atomic<uint64_t> allocCount{0}, allocBytes{0};
+
+void* operator new(size_t n) {
+    allocCount.fetch_add(1, memory_order_relaxed);
+    allocBytes.fetch_add(n, memory_order_relaxed);
+    if (void* p = malloc(n ? n : 1)) return p;
+    throw bad_alloc();
+}
+// Out of line so GCC does not pair the inlined free() with new-expressions.
+__attribute__((noinline)) void operator delete(void* p) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept { free(p); }
+
+// ---------- Harness ----------
+struct BenchConfig {
+    vector<size_t> sizes{1000, 10000, 100000, 1000000};
+    string filter;
+    string dir{"/tmp"};
+    double minTime{0.2}; // seconds a read-only benchmark is repeated for
+} config;
+
+struct Measurement {
+    uint64_t ops{0};
+    double seconds{0};
+    uint64_t allocs{0}, bytes{0};
+};
+
+static bool selected(const string& name) {
+    return config.filter.empty() || name.find(config.filter) != string::npos;
+}
+
+static void emit(const string& name, const char* unit, size_t n, const Measurement& m) {
+    double ops = static_cast<double>(max<uint64_t>(m.ops, 1));
+    printf("{\"bench\":\"%s\",\"unit\":\"%s\",\"n\":%zu,\"ops\":%llu,\"seconds\":%.6f,\"ns_per_op\":%.2f,"
+           "\"ops_per_sec\":%.0f,\"allocs_per_op\":%.3f,\"bytes_per_op\":%.1f}\n",
+           name.c_str(), unit, n, static_cast<unsigned long long>(m.ops), m.seconds, m.seconds * 1e9 / ops,
+           m.seconds > 0 ? m.ops / m.seconds : 0.0, m.allocs / ops, m.bytes / ops);
+    fflush(stdout);
+}
+
+// Time one run of body(), which returns the number of operations it did.
+template <typename F>
+static Measurement measureOnce(F&& body) {
+    Measurement m;
+    uint64_t allocs = allocCount.load(), bytes = allocBytes.load();
+    auto start = chrono::steady_clock::now();
+    m.ops = body();
+    m.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    m.allocs = allocCount.load() - allocs;
+    m.bytes = allocBytes.load() - bytes;
+    return m;
+}
+
+// Repeat a side-effect-free body until config.minTime has passed.
+template <typename F>
+static Measurement measureRepeated(F&& body) {
+    Measurement total;
+    do {
+        Measurement m = measureOnce(body);
+        total.ops += m.ops;
+        total.seconds += m.seconds;
+        total.allocs += m.allocs;
+        total.bytes += m.bytes;
+    } while (total.seconds < config.minTime);
+    return total;
+}
+
+template <typename F>
+static void bench(const string& name, const char* unit, size_t n, F&& run) {
+    if (selected(name)) emit(name, unit, n, run());
+}
+
+// ---------- Fixtures ----------
+static mt19937_64 rng(42);
+static volatile uint8_t sink; // keeps results of pure computations alive
+static const string BENCH_PASSWORD = "bench-pw";
+
+static void resetChain() {
+    stopPipeline();
+    blockchain.blocks.clear();
+    blockchain.txDelta.clear();
+    blockchain.deltaFirstTx = 0;
+    blockchain.deltaBase = 0;
+}
+
+// n accounts sharing one cheap password hash, each with its credential cached
+// so the engine benchmarks measure the session path rather than the KDF.
+static void buildAccounts(BankDatabase& db, size_t n) {
+    initBankDatabase(&db);
+    db.index.reserve(n);
+    const string hash = hashPassword(BENCH_PASSWORD, KdfParams{1, 1, 1});
+    for (size_t i = 0; i < n; ++i) {
+        User* u = createUser(&db, "holder" + to_string(i), "9000000000", hash, 1'000'000);
+        authenticateUser(u, BENCH_PASSWORD);
+    }
+}
+
+static string depositRecord(const User& u, Money amount) {
+    TxRecord t;
+    t.kind = TxKind::Deposit;
+    t.amount = amount;
+    t.balance = u.balance + amount;
+    t.from = u.accountNumber;
+    string data;
+    encodeTx(data, t);
+    return data;
+}
+
+// n deposits spread over the accounts, sealed under the default policy.
+static void buildChain(BankDatabase& db, size_t n) {
+    resetChain();
+    uniform_int_distribution<size_t> pick(0, db.accounts.size() - 1);
+    for (size_t i = 0; i < n; ++i) {
+        addTransaction(depositRecord(*db.accounts[pick(rng)], 100));
+        if (blockchain.blocks.txCount() - blockchain.blocks.sealedTxCount() >= blockchain.policy.maxTxs) sealBlock();
+    }
+    sealBlock();
+}
+
+static vector<string> sampleAccounts(BankDatabase& db, size_t count) {
+    uniform_int_distribution<size_t> pick(0, db.accounts.size() - 1);
+    vector<string> out(count);
+    for (string& s : out) s = db.accounts[pick(rng)]->accountNumber;
+    return out;
+}
+
+// ---------- Benchmarks ----------
+static void benchHashing(size_t n) {
+    vector<Block> blocks(n);
+    for (size_t i = 0; i < n; ++i) {
+        blocks[i].index = static_cast<int64_t>(i);
+        blocks[i].timestamp = 1700000000 + static_cast<int64_t>(i);
+        blocks[i].firstTx = i;
+        blocks[i].txCount = 1;
+        randomBytes(blocks[i].merkleRoot.data(), blocks[i].merkleRoot.size());
+    }
+    bench("computeHash", "block", n, [&] {
+        return measureRepeated([&] {
+            Hash256 acc{};
+            for (Block& b : blocks) {
+                b.previousHash = acc;
+                acc = computeHash(b);
+            }
+            sink = acc[0];
+            return uint64_t(n);
+        });
+    });
+}
+
+static void benchChain(size_t n) {
+    BankDatabase db;
+    buildAccounts(db, min<size_t>(n, 100000));
+
+    bench("addTransaction+seal", "tx", n, [&] {
+        resetChain();
+        vector<string> payloads;
+        payloads.reserve(256);
+        for (size_t i = 0; i < 256; ++i) payloads.push_back(depositRecord(*db.accounts[i % db.accounts.size()], 100));
+        return measureOnce([&] {
+            for (size_t i = 0; i < n; ++i) {
+                addTransaction(payloads[i & 255]);
+                maybeSeal();
+            }
+            sealBlock();
+            return uint64_t(n);
+        });
+    });
+
+    buildChain(db, n);
+    const BlockStore& store = blockchain.blocks;
+
+    bench("merkleRoot", "tx", n, [&] {
+        return measureRepeated([&] {
+            sink = merkleRoot(store, 0, store.txCount())[0];
+            return uint64_t(store.txCount());
+        });
+    });
+
+    bench("verifyChain", "tx", n, [&] {
+        return measureRepeated([&] {
+            if (verifyChain().firstBad >= 0) cerr << "verifyChain: chain reported broken\n";
+            return uint64_t(store.txCount());
+        });
+    });
+
+    vector<string> ids(min<size_t>(n, 1 << 20));
+    uniform_int_distribution<uint64_t> pickTx(0, store.txCount() - 1);
+    for (string& id : ids) id = transactionID(pickTx(rng));
+    bench("lookupTransaction", "lookup", n, [&] {
+        return measureRepeated([&] {
+            TxLookup t;
+            for (const string& id : ids) lookupTransaction(id, t);
+            return uint64_t(ids.size());
+        });
+    });
+
+    // The chain is sealed within a few seconds; spread the blocks one second
+    // apart, with a clock step back halfway, then query 64-block windows.
+    bench("findBlocksInTime", "query", n, [&] {
+        vector<int64_t> saved(store.size());
+        for (size_t i = 0; i < store.size(); ++i) {
+            saved[i] = store[i].timestamp;
+            blockchain.blocks.appended(i).timestamp = int64_t(i < store.size() / 2 ? i : i - store.size() / 4);
+        }
+        blockchain.timeIndex = TimeIndex();
+        vector<int64_t> starts(4096);
+        uniform_int_distribution<int64_t> pickTime(0, int64_t(store.size()));
+        for (int64_t& t : starts) t = pickTime(rng);
+        Measurement m = measureRepeated([&] {
+            for (int64_t t : starts) sink = findBlocksInTime(t, t + 63).size();
+            return uint64_t(starts.size());
+        });
+        for (size_t i = 0; i < store.size(); ++i) blockchain.blocks.appended(i).timestamp = saved[i];
+        blockchain.timeIndex = TimeIndex();
+        return m;
+    });
+
+    bench("renderTransaction", "tx", n, [&] {
+        string text;
+        return measureRepeated([&] {
+            for (uint64_t i = 0; i < store.txCount(); ++i) {
+                text.clear();
+                appendTxText(text, store.tx(i));
+            }
+            return uint64_t(store.txCount());
+        });
+    });
+
+    bench("buildAccountHistory", "tx", n, [&] {
+        return measureOnce([&] {
+            buildAccountHistory(&db);
+            return uint64_t(store.txCount());
+        });
+    });
+
+    bench("buildLedgerDeltas+reconcile", "tx", n, [&] {
+        return measureOnce([&] {
+            buildLedgerDeltas();
+            reconcile(&db);
+            return uint64_t(store.txCount());
+        });
+    });
+
+    const string csv = config.dir + "/bench-transactions.csv", bin = config.dir + "/bench-ledger.bin";
+    bench("saveTransactionsToCSV", "row", n, [&] {
+        return measureOnce([&] {
+            saveTransactionsToCSV(csv);
+            return uint64_t(store.txCount());
+        });
+    });
+    bench("writeLedger", "tx", n, [&] {
+        return measureOnce([&] {
+            writeLedger(bin);
+            return uint64_t(store.txCount());
+        });
+    });
+    if (selected("loadTransactionsFromCSV")) {
+        if (!selected("saveTransactionsToCSV")) saveTransactionsToCSV(csv);
+        resetChain();
+        emit("loadTransactionsFromCSV", "row", n, measureOnce([&] {
+            loadTransactionsFromCSV(csv, CsvLoad::AsStored);
+            return uint64_t(blockchain.blocks.txCount());
+        }));
+    }
+    if (selected("openLedger")) {
+        if (!selected("writeLedger")) {
+            buildChain(db, n);
+            writeLedger(bin);
+        }
+        resetChain();
+        emit("openLedger", "tx", n, measureOnce([&] {
+            openLedger(bin);
+            return uint64_t(blockchain.blocks.txCount());
+        }));
+    }
+    unlink(csv.c_str());
+    unlink(bin.c_str());
+    resetChain();
+}
+
+static void benchAccounts(size_t n) {
+    BankDatabase db;
+    bench("createUser", "account", n, [&] {
+        initBankDatabase(&db);
+        return measureOnce([&] {
+            for (size_t i = 0; i < n; ++i) createUser(&db, "holder", "9000000000", "hash", 1'000'000);
+            return uint64_t(n);
+        });
+    });
+
+    buildAccounts(db, n);
+    vector<string> hits = sampleAccounts(db, min<size_t>(n, 1 << 20)), misses = hits;
+    for (string& s : misses) s += 'X';
+    bench("findUser/hit", "lookup", n, [&] {
+        return measureRepeated([&] {
+            for (const string& s : hits)
+                if (!findUser(&db, s)) cerr << "findUser: missing " << s << "\n";
+            return uint64_t(hits.size());
+        });
+    });
+    bench("findUser/miss", "lookup", n, [&] {
+        return measureRepeated([&] {
+            for (const string& s : misses)
+                if (findUser(&db, s)) cerr << "findUser: unexpected " << s << "\n";
+            return uint64_t(misses.size());
+        });
+    });
+    bench("authenticateUser/cached", "lookup", n, [&] {
+        return measureRepeated([&] {
+            for (const string& s : hits) authenticateUser(findUser(&db, s), BENCH_PASSWORD);
+            return uint64_t(hits.size());
+        });
+    });
+
+    const string users = config.dir + "/bench-users.csv";
+    bench("saveUsersToCSV", "row", n, [&] {
+        return measureOnce([&] {
+            saveUsersToCSV(&db, users);
+            return uint64_t(n);
+        });
+    });
+    if (selected("loadUsersFromCSV")) {
+        if (!selected("saveUsersToCSV")) saveUsersToCSV(&db, users);
+        BankDatabase loaded;
+        initBankDatabase(&loaded);
+        emit("loadUsersFromCSV", "row", n, measureOnce([&] {
+            loadUsersFromCSV(&loaded, users);
+            return uint64_t(loaded.accounts.size());
+        }));
+    }
+    unlink(users.c_str());
+
+    // Engine operations through the commit pipeline; the timing includes
+    // draining the sealer so every transaction is in a block.
+    vector<string> to = sampleAccounts(db, hits.size());
+    bench("applyTransaction/deposit", "op", n, [&] {
+        resetChain();
+        startPipeline();
+        return measureOnce([&] {
+            for (const string& s : hits) applyTransaction(&db, s, BENCH_PASSWORD, 100, 1);
+            sealAndFlush();
+            return uint64_t(hits.size());
+        });
+    });
+    bench("transferFunds", "op", n, [&] {
+        resetChain();
+        startPipeline();
+        return measureOnce([&] {
+            for (size_t i = 0; i < hits.size(); ++i) transferFunds(&db, hits[i], BENCH_PASSWORD, to[i], 1);
+            sealAndFlush();
+            return uint64_t(hits.size());
+        });
+    });
+    resetChain();
+}
+
+static vector<size_t> parseSizes(const string& s) {
+    vector<size_t> out;
+    stringstream in(s);
+    string item;
+    while (getline(in, item, ','))
+        if (size_t v; parseInt(item, v) && v) out.push_back(v);
+    return out;
+}
+
+int main(int argc, char** argv) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string arg = argv[i], next = argv[i + 1];
+        if (arg == "--sizes") config.sizes = parseSizes(next);
+        else if (arg == "--filter") config.filter = next;
+        else if (arg == "--dir") config.dir = next;
+        else if (arg == "--min-time") config.minTime = atof(next.c_str());
+        else {
+            cerr << "Usage: " << argv[0] << " [--sizes N,N,...] [--filter name] [--dir path] [--min-time secs]\n";
+            return 1;
+        }
+    }
+    printf("{\"machine\":{\"threads\":%u,\"sha256\":\"%s\",\"avx2\":%s,\"block_txs\":%zu}}\n",
+           max(1u, thread::hardware_concurrency()), sha256Impl().name, cpuHasAvx2() ? "true" : "false",
+           blockchain.policy.maxTxs);
+    for (size_t n : config.sizes) {
+        benchHashing(n);
+        benchChain(n);
+        benchAccounts(n);
+    }
+    return 0;
+}
@@ -0,0 +1,458 @@
+// Synthetic workloads: a generator that writes an account population and a
+// command stream in the program's own formats, and a driver that replays the
+// stream through the engine at a target rate. Built like benchmark.cpp:
+//
+//   g++ -std=c++17 -O2 -pthread workload.cpp -o workload
+//   ./workload generate <dir> [--accounts N] [--ops N] [--zipf S] [--mix D,W,T,C] [--seed N] [--kdf-cost N]
+//   ./workload replay <dir> [--rate OPS_PER_SEC] [--threads N] [--warm] [--kdf-cost N]
+//   ./workload load <dir> --connect ADDRESS [--connections N] [--depth N] [--threads N]
+//
+// generate writes <dir>/users.csv, <dir>/transactions.csv holding each
+// account's opening deposit (so the books reconcile) and <dir>/commands.csv
+// (the --batch format). Activity is Zipfian over the accounts: the k-th busiest account
+// is picked with weight 1/k^S, and which accounts are busy is shuffled.
+// Amounts and opening balances are log-normal. --mix gives the percentages
+// of deposits, withdrawals, transfers and account creations.
+//
+// replay opens the bank in <dir> and pushes the commands through the engine
+// (openAccount, applyTransaction, transferFunds). With --rate, command i is
+// due at start + i / rate and its latency is measured from that moment, so
+// a stalled engine shows up as queueing delay rather than a slower offered
+// load. Results are one JSON line: throughput, latency percentiles and
+// status counts. --warm verifies every password before the clock starts;
+// otherwise each account's first command pays the password hash.
+//
+// load sends the same commands to a running --serve process instead (see
+// "Load test" below).
+#define main bankMain
+#include "BankingSystemusingBlockchain.cpp"
+#undef main
+
+// ---------- Generator ----------
+struct WorkloadSpec {
+    size_t accounts{10000};
+    size_t ops{1000000};
+    double zipf{1.1};
+    unsigned mix[4]{45, 25, 29, 1}; // deposit, withdraw, transfer, create
+    uint64_t seed{1};
+};
+
+static string workloadPassword(const string& accountNumber) { return "pw-" + accountNumber; }
+
+static string workloadMobile(uint64_t i) {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "9%09llu", static_cast<unsigned long long>(i % 1000000000));
+    return buf;
+}
+
+// Samples ranks 0..n-1 with P(k) proportional to 1 / (k + 1)^s.
+struct ZipfSampler {
+    vector<double> cdf;
+
+    ZipfSampler(size_t n, double s) : cdf(n) {
+        double sum = 0;
+        for (size_t k = 0; k < n; ++k) cdf[k] = sum += pow(double(k + 1), -s);
+        for (double& c : cdf) c /= sum;
+    }
+    template <typename Rng>
+    size_t operator()(Rng& rng) const {
+        double u = uniform_real_distribution<double>(0, 1)(rng);
+        return min<size_t>(upper_bound(cdf.begin(), cdf.end(), u) - cdf.begin(), cdf.size() - 1);
+    }
+};
+
+// Log-normal amount in paise around `median`, clamped to [lo, hi].
+template <typename Rng>
+static Money lognormalMoney(Rng& rng, Money median, double sigma, Money lo, Money hi) {
+    double v = lognormal_distribution<double>(log(double(median)), sigma)(rng);
+    return clamp<Money>(static_cast<Money>(v), lo, hi);
+}
+
+static bool generateWorkload(const string& dir, const WorkloadSpec& spec) {
+    if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        cerr << "Failed to create directory: " << dir << "\n";
+        return false;
+    }
+    for (const string& existing : {USERS_CSV, TX_CSV, LEDGER_BIN, JOURNAL})
+        if (access((dir + "/" + existing).c_str(), F_OK) == 0) {
+            cerr << dir << " already holds a bank (" << existing << "); generate into a new directory\n";
+            return false;
+        }
+    mt19937_64 rng(spec.seed);
+
+    // Population: account numbers as the engine assigns them, passwords hashed in parallel.
+    const size_t n = max<size_t>(spec.accounts, 2);
+    vector<string> numbers(n), hashes(n);
+    for (size_t i = 0; i < n; ++i) {
+        ostringstream acc;
+        acc << "CSAGRP6A" << setw(3) << setfill('0') << i + 1;
+        numbers[i] = acc.str();
+    }
+    parallelFor(n, 64, [&](size_t lo, size_t hi) {
+        for (size_t i = lo; i < hi; ++i) hashes[i] = hashPassword(workloadPassword(numbers[i]));
+    });
+    BankDatabase db;
+    initBankDatabase(&db);
+    db.index.reserve(n);
+    for (size_t i = 0; i < n; ++i)
+        createUser(&db, "Customer " + to_string(i + 1), workloadMobile(i), hashes[i],
+                   lognormalMoney(rng, 2'000'000, 1.0, 10'000, 1'000'000'000), numbers[i]);
+    saveUsersToCSV(&db, dir + "/" + USERS_CSV);
+    forEachAccount(&db, [](const User& u) {
+        TxRecord t;
+        t.kind = TxKind::Open;
+        t.amount = t.balance = u.balance;
+        t.from = u.accountNumber;
+        t.to = u.name;
+        string data;
+        encodeTx(data, t);
+        addTransaction(std::move(data));
+        maybeSeal();
+    });
+    sealBlock();
+    saveTransactionsToCSV(dir + "/" + TX_CSV);
+
+    // Command stream. Busy accounts are a random subset, not the lowest numbers.
+    vector<size_t> byRank(n);
+    iota(byRank.begin(), byRank.end(), 0);
+    shuffle(byRank.begin(), byRank.end(), rng);
+    ZipfSampler zipf(n, spec.zipf);
+    auto pick = [&] { return byRank[zipf(rng)]; };
+    const unsigned total = spec.mix[0] + spec.mix[1] + spec.mix[2] + spec.mix[3];
+    uniform_int_distribution<unsigned> kind(0, total - 1);
+
+    const string path = dir + "/commands.csv";
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        cerr << "Failed to open file: " << path << "\n";
+        return false;
+    }
+    BufferedWriter out(fd);
+    string line;
+    for (size_t i = 0; i < spec.ops; ++i) {
+        unsigned k = kind(rng);
+        size_t a = pick();
+        Money amount = lognormalMoney(rng, 50'000, 1.2, 100, 10'000'000);
+        line.clear();
+        if (k < spec.mix[0] + spec.mix[1]) {
+            line += k < spec.mix[0] ? "deposit," : "withdraw,";
+            line += numbers[a] + ',' + workloadPassword(numbers[a]) + ',';
+        } else if (k < spec.mix[0] + spec.mix[1] + spec.mix[2]) {
+            size_t b = pick();
+            while (b == a) b = pick();
+            line += "transfer," + numbers[a] + ',' + workloadPassword(numbers[a]) + ',' + numbers[b] + ',';
+        } else {
+            string name = "Customer " + to_string(n + i + 1);
+            line += "create," + name + ',' + workloadMobile(n + i) + ",pw-new-" + to_string(i) + ',';
+        }
+        appendMoney(line, amount);
+        line += '\n';
+        out.write(line);
+    }
+    out.flush();
+    bool ok = out.ok;
+    close(fd);
+    if (!ok) cerr << "Failed to write file: " << path << "\n";
+    cerr << "Wrote " << n << " accounts to " << dir << "/" << USERS_CSV << " and " << TX_CSV << ", and " << spec.ops
+         << " commands to " << path << "\n";
+    return ok;
+}
+
+// ---------- Replay ----------
+struct ReplayResult {
+    vector<uint64_t> latencyNs; // per command, in completion order within each worker
+    map<string, size_t> statuses;
+};
+
+static double percentile(const vector<uint64_t>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t i = min(sorted.size() - 1, static_cast<size_t>(p / 100 * sorted.size()));
+    return sorted[i] / 1000.0;
+}
+
+// Prints the latency percentiles and status counts that close a result line.
+static void printLatencies(vector<ReplayResult>& results) {
+    vector<uint64_t> all;
+    map<string, size_t> statuses;
+    for (ReplayResult& r : results) {
+        all.insert(all.end(), r.latencyNs.begin(), r.latencyNs.end());
+        for (const auto& [name, count] : r.statuses) statuses[name] += count;
+    }
+    sort(all.begin(), all.end());
+    printf("\"latency_us\":{\"p50\":%.1f,\"p90\":%.1f,\"p99\":%.1f,\"p999\":%.1f,\"max\":%.1f},\"status\":{",
+           percentile(all, 50), percentile(all, 90), percentile(all, 99), percentile(all, 99.9),
+           all.empty() ? 0.0 : all.back() / 1000.0);
+    const char* sep = "";
+    for (const auto& [name, count] : statuses) {
+        printf("%s\"%s\":%zu", sep, name.c_str(), count);
+        sep = ",";
+    }
+    printf("}}\n");
+}
+
+static void countStatus(ReplayResult& r, const string& result) {
+    size_t a = result.find(',') + 1;
+    ++r.statuses[result.substr(a, result.find(',', a) - a)];
+}
+
+// Commands on one account keep their order: route each to a lane by its first account.
+static size_t routeCommand(string_view v, size_t lanes) {
+    size_t a = v.find(',') + 1, b = v.find(',', a);
+    return hash<string_view>{}(v.substr(a, b - a)) % lanes;
+}
+
+static bool readCommands(const string& dir, vector<string>& lines) {
+    ifstream in(dir + "/commands.csv");
+    if (!in) {
+        cerr << "Failed to open file: " << dir << "/commands.csv\n";
+        return false;
+    }
+    string line;
+    for (size_t lineNo = 0; readCommand(in, line, lineNo);) lines.push_back(line);
+    return true;
+}
+
+static int replayWorkload(const string& dir, double rate, unsigned threads, bool warm) {
+    vector<string> lines;
+    if (!readCommands(dir, lines)) return 1;
+    if (chdir(dir.c_str()) != 0) {
+        cerr << "Failed to enter directory: " << dir << "\n";
+        return 1;
+    }
+    BankDatabase db;
+    openBank(&db);
+    if (warm) {
+        vector<User*> users = db.accounts;
+        parallelFor(users.size(), 16, [&](size_t lo, size_t hi) {
+            for (size_t i = lo; i < hi; ++i) authenticateUser(users[i], workloadPassword(users[i]->accountNumber));
+        });
+    }
+
+    // Commands on one account stay in order on one worker, as in --threads batch mode.
+    vector<vector<size_t>> queues(threads);
+    for (size_t k = 0; k < lines.size(); ++k) queues[routeCommand(lines[k], threads)].push_back(k);
+    vector<ReplayResult> results(threads);
+    const auto start = chrono::steady_clock::now();
+    auto due = [&](size_t k) {
+        return start + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(k / rate));
+    };
+    vector<thread> pool;
+    for (unsigned t = 0; t < threads; ++t)
+        pool.emplace_back([&, t] {
+            ReplayResult& r = results[t];
+            r.latencyNs.reserve(queues[t].size());
+            vector<string> fields;
+            string result;
+            for (size_t k : queues[t]) {
+                auto begin = chrono::steady_clock::now();
+                if (rate > 0) {
+                    auto when = due(k);
+                    if (when > begin) this_thread::sleep_until(when);
+                    begin = when;
+                }
+                result.clear();
+                runCommand(&db, lines[k], k + 1, fields, result);
+                r.latencyNs.push_back(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - begin).count());
+                countStatus(r, result);
+            }
+        });
+    for (auto& th : pool) th.join();
+    const double ran = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    sealAndFlush();
+    const double drained = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    closeJournal();
+
+    printf("{\"commands\":%zu,\"threads\":%u,\"target_rate\":%.0f,\"seconds\":%.3f,\"ops_per_sec\":%.0f,"
+           "\"drained_seconds\":%.3f,",
+           lines.size(), threads, rate, ran, ran > 0 ? lines.size() / ran : 0.0, drained);
+    printLatencies(results);
+    printReconcileReport(reconcile(&db), cerr);
+    printPipelineStats(cerr);
+    return 0;
+}
+
+// ---------- Load test ----------
+// load plays <dir>/commands.csv against a --serve process over --connections
+// sockets (spread over --threads client threads, each with its own epoll
+// loop), keeping up to --depth requests in flight on each. Commands on one
+// account go to one connection, so the server sees them in order. Latency
+// runs from queueing a request on its socket to reading its result line.
+struct LoadConnection {
+    int fd{-1};
+    vector<size_t> commands; // indices into the command lines, in send order
+    size_t sent{0}, answered{0};
+    deque<chrono::steady_clock::time_point> inFlight;
+    string in, out;
+    size_t outPos{0};
+};
+
+static int connectTo(const SocketAddress& addr) {
+    int fd = socket(addr.addr.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<const sockaddr*>(&addr.addr), addr.len) != 0) {
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    int one = 1;
+    if (addr.path.empty()) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+// Queue requests up to the depth, then write and read what the socket allows.
+// Returns false on a connection error.
+static bool driveConnection(LoadConnection& c, const vector<string>& lines, size_t depth, ReplayResult& r) {
+    char buf[1 << 16];
+    for (;;) {
+        ssize_t got = read(c.fd, buf, sizeof(buf));
+        if (got == 0) return false;
+        if (got < 0) {
+            if (errno == EAGAIN || errno == EINTR) break;
+            return false;
+        }
+        c.in.append(buf, size_t(got));
+    }
+    size_t pos = 0;
+    for (size_t nl; (nl = c.in.find('\n', pos)) != string::npos && !c.inFlight.empty(); pos = nl + 1) {
+        auto now = chrono::steady_clock::now();
+        r.latencyNs.push_back(chrono::duration_cast<chrono::nanoseconds>(now - c.inFlight.front()).count());
+        c.inFlight.pop_front();
+        countStatus(r, c.in.substr(pos, nl - pos));
+        ++c.answered;
+    }
+    c.in.erase(0, pos);
+    auto now = chrono::steady_clock::now();
+    for (; c.sent < c.commands.size() && c.sent - c.answered < depth; ++c.sent) {
+        c.out += lines[c.commands[c.sent]];
+        c.out += '\n';
+        c.inFlight.push_back(now);
+    }
+    while (c.outPos < c.out.size()) {
+        ssize_t sent = send(c.fd, c.out.data() + c.outPos, c.out.size() - c.outPos, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EAGAIN || errno == EINTR) break;
+            return false;
+        }
+        c.outPos += size_t(sent);
+    }
+    if (c.outPos == c.out.size()) c.out.clear(), c.outPos = 0;
+    return true;
+}
+
+static int loadServer(const string& dir, const string& address, size_t connections, size_t depth, unsigned threads) {
+    SocketAddress addr;
+    if (!parseSocketAddress(address, addr)) {
+        cerr << "Invalid address: " << address << "\n";
+        return 1;
+    }
+    vector<string> lines;
+    if (!readCommands(dir, lines)) return 1;
+    raiseFileLimit();
+    connections = max<size_t>(1, min(connections, lines.size()));
+    threads = static_cast<unsigned>(min<size_t>(threads, connections));
+
+    vector<LoadConnection> conns(connections);
+    for (size_t k = 0; k < lines.size(); ++k) conns[routeCommand(lines[k], connections)].commands.push_back(k);
+    for (LoadConnection& c : conns)
+        if ((c.fd = connectTo(addr)) < 0) {
+            cerr << "Failed to connect to " << address << ": " << strerror(errno) << "\n";
+            for (LoadConnection& o : conns)
+                if (o.fd >= 0) close(o.fd);
+            return 1;
+        }
+
+    vector<ReplayResult> results(threads);
+    atomic<size_t> failed{0};
+    const auto start = chrono::steady_clock::now();
+    vector<thread> pool;
+    for (unsigned t = 0; t < threads; ++t)
+        pool.emplace_back([&, t] {
+            ReplayResult& r = results[t];
+            int ep = epoll_create1(EPOLL_CLOEXEC);
+            size_t open = 0;
+            for (size_t i = t; i < conns.size(); i += threads) {
+                LoadConnection& c = conns[i];
+                if (c.commands.empty()) continue;
+                epoll_event ev{};
+                ev.events = EPOLLIN | EPOLLOUT | EPOLLET;
+                ev.data.ptr = &c;
+                epoll_ctl(ep, EPOLL_CTL_ADD, c.fd, &ev);
+                ++open;
+            }
+            epoll_event events[256];
+            while (open) {
+                int n = epoll_wait(ep, events, 256, -1);
+                for (int i = 0; i < n; ++i) {
+                    auto& c = *static_cast<LoadConnection*>(events[i].data.ptr);
+                    if (c.fd < 0) continue;
+                    bool ok = driveConnection(c, lines, depth, r);
+                    if (!ok || c.answered == c.commands.size()) {
+                        if (!ok) failed.fetch_add(c.commands.size() - c.answered);
+                        close(c.fd);
+                        c.fd = -1;
+                        --open;
+                    }
+                }
+            }
+            close(ep);
+        });
+    for (auto& th : pool) th.join();
+    const double ran = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    for (LoadConnection& c : conns)
+        if (c.fd >= 0) close(c.fd);
+
+    const size_t done = lines.size() - failed.load();
+    printf("{\"commands\":%zu,\"connections\":%zu,\"depth\":%zu,\"threads\":%u,\"seconds\":%.3f,"
+           "\"ops_per_sec\":%.0f,\"unanswered\":%zu,",
+           lines.size(), connections, depth, threads, ran, ran > 0 ? done / ran : 0.0, failed.load());
+    printLatencies(results);
+    return failed.load() ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+    const string usage = string("Usage: ") + argv[0] +
+                         " generate <dir> [--accounts N] [--ops N] [--zipf S] [--mix D,W,T,C] [--seed N] [--kdf-cost N]\n"
+                         "       " + argv[0] + " replay <dir> [--rate OPS_PER_SEC] [--threads N] [--warm] [--kdf-cost N]\n"
+                         "       " + argv[0] + " load <dir> --connect ADDRESS [--connections N] [--depth N] [--threads N]\n";
+    if (argc < 3) {
+        cerr << usage;
+        return 1;
+    }
+    const string mode = argv[1], dir = argv[2];
+    WorkloadSpec spec;
+    double rate = 0;
+    unsigned threads = 1;
+    bool warm = false;
+    string address;
+    size_t connections = 64, depth = 16;
+    kdfParams.logN = 8; // cheap hashes for generated populations unless --kdf-cost says otherwise
+    for (int i = 3; i < argc; ++i) {
+        string arg = argv[i], next = i + 1 < argc ? argv[i + 1] : "";
+        bool ok = true;
+        if (arg == "--warm") warm = true;
+        else if (next.empty()) ok = false;
+        else if (arg == "--accounts") ok = parseInt(next, spec.accounts), ++i;
+        else if (arg == "--ops") ok = parseInt(next, spec.ops), ++i;
+        else if (arg == "--seed") ok = parseInt(next, spec.seed), ++i;
+        else if (arg == "--connect") address = next, ++i;
+        else if (arg == "--connections") ok = parseInt(next, connections) && connections >= 1, ++i;
+        else if (arg == "--depth") ok = parseInt(next, depth) && depth >= 1, ++i;
+        else if (arg == "--threads") ok = parseInt(next, threads) && threads >= 1 && threads <= 1024, ++i;
+        else if (arg == "--kdf-cost") ok = parseInt(next, kdfParams.logN) && kdfParams.logN >= 1 && kdfParams.logN <= 24, ++i;
+        else if (arg == "--zipf") spec.zipf = atof(next.c_str()), ok = spec.zipf >= 0, ++i;
+        else if (arg == "--rate") rate = atof(next.c_str()), ok = rate >= 0, ++i;
+        else if (arg == "--mix")
+            ok = sscanf(next.c_str(), "%u,%u,%u,%u", &spec.mix[0], &spec.mix[1], &spec.mix[2], &spec.mix[3]) == 4 &&
+                 spec.mix[0] + spec.mix[1] + spec.mix[2] + spec.mix[3] > 0,
+            ++i;
+        else ok = false;
+        if (!ok) {
+            cerr << usage;
+            return 1;
+        }
+    }
+    if (mode == "generate") return generateWorkload(dir, spec) ? 0 : 1;
+    if (mode == "replay") return replayWorkload(dir, rate, threads, warm);
+    if (mode == "load" && !address.empty()) return loadServer(dir, address, connections, depth, threads);
+    cerr << usage;
+    return 1;
+}